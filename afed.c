@@ -4,8 +4,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <errno.h>
 #include <getopt.h>
+#include <pthread.h>
 
 #define PROG_NAME "afed"
 
@@ -13,11 +15,50 @@
 FILE *infile = NULL;
 FILE *outfile = NULL;
 FILE *errfile = NULL;
+// Previous version of input to compare against
+FILE *oldfile = NULL;
+// Path of output file or NULL if it is STDOUT
+const char *outpath = NULL;
 
 bool only_check = 0;
 bool allow_overwrite = 1;
 bool show_errors = 1;
 
+// Alternate document produced by overriding definitions of the input
+struct scenario_s {
+	const char *name;  // Name given on the command line
+	const char *path;  // File containing overriding definitions
+	char *prog;
+	
+	namespace_t nmsp;  // Fork of the input's namespace
+	docmt_t overrides, doc;
+	
+	// Output is buffered when printed to STDOUT
+	FILE *out, *err;
+	char *outbuf, *errbuf;
+	size_t outlen, errlen;
+	
+	int errcnt;
+	pthread_t thread;
+};
+
+size_t scen_count = 0;
+struct scenario_s *scenarios = NULL;
+
+// Names of rounding modes used by `round`
+struct {
+	const char *name;
+	enum arith_rounding mode;
+} round_modes[] = {
+	{"half-even", ARITH_ROUND_HALF_EVEN},
+	{"half-up", ARITH_ROUND_HALF_UP},
+	{"down", ARITH_ROUND_DOWN},
+	{"up", ARITH_ROUND_UP},
+	{"floor", ARITH_ROUND_FLOOR},
+	{"ceil", ARITH_ROUND_CEIL},
+	{0}
+};
+
 const char help_msg[] =
 	"Usage: " PROG_NAME " [OPTION]... [-i] INFILE [[-o] OUTFILE]\n"
 	"\n"
@@ -26,7 +67,13 @@ const char help_msg[] =
 	"  -i, --input INFILES...  List of files to evaluate\n"
 	"  -o, --output OUTFILE    Output file to store result to\n"
 	"  -C, --check             Don't output file only check for errors\n"
+	"  -c, --compare OLDFILE   Only output the results of INFILE which differ from those of OLDFILE\n"
+	"                          Output is sent to STDOUT if OUTFILE is not given. Exits with 1 if any differ\n"
 	"  -n, --no-clobber        Make sure none of the INFILES are used as outputs\n"
+	"  -s, --scenario NAME=FILE  Also evaluate with the definitions in FILE replacing those of INFILE\n"
+	"                          Written to OUTFILE with \".NAME\" before its extension\n"
+	"  -r, --round MODE        Rounding used by round(x, places): half-even (default), half-up,\n"
+	"                          down, up, floor, or ceil\n"
 	"  -e, --errors ERRFILE    File to send errors to. Sent to stderr if not specified\n"
 	"  -E, --no-errors         Don't print any error messages\n"
 	"  -h, --help              Print this help message\n"
@@ -40,6 +87,9 @@ struct option longopts[] = {
 	{"input", required_argument, NULL, 'i'},
 	{"output", required_argument, NULL, 'o'},
 	{"check", no_argument, NULL, 'C'},
+	{"compare", required_argument, NULL, 'c'},
+	{"scenario", required_argument, NULL, 's'},
+	{"round", required_argument, NULL, 'r'},
 	{"no-clobber", no_argument, NULL, 'n'},
 	{"errors", required_argument, NULL, 'e'},
 	{"no-errors", required_argument, NULL, 'E'},
@@ -50,6 +100,7 @@ struct option longopts[] = {
 void leave(int code){
 	// Close open file descriptors
 	if(infile) fclose(infile);
+	if(oldfile) fclose(oldfile);
 	if(outfile && outfile != infile) fclose(outfile);
 	if(errfile) fclose(errfile);
 	
@@ -65,15 +116,23 @@ void parse_opt(int key){
 		case 'i':  // Input file
 				if(infile) usage(2, "Input file already given\n");
 				if(optarg[0] == '-' && optarg[1] == '\0') infile = stdin;
-				else infile = fopen(optarg, "r+");  // Allow modification in case infile is used as outfile
+				else{
+					infile = fopen(optarg, "r+");  // Allow modification in case infile is used as outfile
+					if(!outfile) outpath = optarg;
+				}
 				
 				// Check that it opened
 				if(!infile) usage(1, "Input file \"%s\" did not open: ERRNO %i\n", optarg, errno);
 			}else{
 		case 'o':  // Output file
 				if(outfile) usage(2, "Output file already given\n");
-				if(optarg[0] == '-' && optarg[1] == '\0') outfile = stdout;
-				else outfile = fopen(optarg, "w");
+				if(optarg[0] == '-' && optarg[1] == '\0'){
+					outfile = stdout;
+					outpath = NULL;
+				}else{
+					outfile = fopen(optarg, "w");
+					outpath = optarg;
+				}
 				
 				// Check that it opened
 				if(!outfile) usage(1, "Output file \"%s\" did not open: ERRNO %i\n", optarg, errno);
@@ -88,6 +147,35 @@ void parse_opt(int key){
 		case 'n': allow_overwrite = 0;
 		break;
 		
+		case 'c':  // Old version of input
+			if(oldfile) usage(2, "Compared file already given\n");
+			oldfile = fopen(optarg, "r");
+			
+			// Check that it opened
+			if(!oldfile) usage(1, "Compared file \"%s\" did not open: ERRNO %i\n", optarg, errno);
+		break;
+		
+		case 's':  // Scenario
+			scenarios = realloc(scenarios, sizeof(struct scenario_s) * (scen_count + 1));
+			struct scenario_s *sc = scenarios + scen_count;
+			memset(sc, 0, sizeof(struct scenario_s));
+			
+			// Split argument at '='
+			char *eq = strchr(optarg, '=');
+			if(!eq || eq == optarg || eq[1] == '\0') usage(2, "Scenario \"%s\" should be of the form NAME=FILE\n", optarg);
+			*eq = '\0';
+			sc->name = optarg;
+			sc->path = eq + 1;
+			scen_count++;
+		break;
+		
+		case 'r':{  // Rounding mode
+			int i = 0;
+			while(round_modes[i].name && strcmp(round_modes[i].name, optarg) != 0) i++;
+			if(!round_modes[i].name) usage(2, "Unknown rounding mode \"%s\"\n", optarg);
+			arith_set_rounding(round_modes[i].mode);
+		}break;
+		
 		case 'e':  // Error file
 			if(errfile) usage(4, "Error file already given\n");	
 			if(optarg[0] == '-' && optarg[1] == '\0') errfile = stdout;
@@ -111,14 +199,49 @@ void parse_opt(int key){
 
 
 
-// Read contents of file into heap allocated string
-char *read_file(FILE *fl);
+// Parse overriding definitions of scenario into fork of `nmsp`
+// Returns number of parse errors
+int load_scenario(struct scenario_s *sc, namespace_t nmsp, docmt_t doc){
+	FILE *fl = fopen(sc->path, "r");
+	if(!fl) usage(1, "Scenario file \"%s\" did not open: ERRNO %i\n", sc->path, errno);
+	sc->prog = docmt_read_file(fl);
+	fclose(fl);
+	
+	sc->err = open_memstream(&sc->errbuf, &sc->errlen);
+	sc->nmsp = nmsp_fork(nmsp);
+	sc->overrides = docmt_new(sc->prog, sc->nmsp);
+	int errcnt = docmt_parse(sc->overrides, sc->err);
+	
+	// Print input document using the scenario's variables
+	sc->doc = docmt_fork(doc, sc->nmsp);
+	if(only_check) sc->out = NULL;
+	else if(!outpath) sc->out = open_memstream(&sc->outbuf, &sc->outlen);
+	else{
+		// Insert name of scenario before extension of output
+		const char *ext = strrchr(outpath, '.');
+		if(!ext || strchr(ext, '/')) ext = outpath + strlen(outpath);
+		
+		char path[strlen(outpath) + strlen(sc->name) + 2];
+		sprintf(path, "%.*s.%s%s", (int)(ext - outpath), outpath, sc->name, ext);
+		if(!(sc->out = fopen(path, "w"))) usage(1, "Scenario output \"%s\" did not open: ERRNO %i\n", path, errno);
+	}
+	return errcnt;
+}
+
+// Evaluate and print document of scenario
+void *run_scenario(void *arg){
+	struct scenario_s *sc = arg;
+	sc->errcnt = docmt_fprint(sc->doc, sc->out, sc->err);
+	return NULL;
+}
+
+
 
 int main(int argc, char *argv[]){
 	// Parse Command Line Arguments
 	// -----------------------------
 	int c;
-	while((c = getopt_long(argc, argv, "i:o:e:nEC", longopts, NULL)) != -1) parse_opt(c);
+	while((c = getopt_long(argc, argv, "i:o:e:s:c:r:nEC", longopts, NULL)) != -1) parse_opt(c);
 	for(int i = optind; i < argc; i++){
 		optarg = argv[i];
 		parse_opt(-1);
@@ -127,6 +250,9 @@ int main(int argc, char *argv[]){
 	// Make sure an infile was given
 	if(!infile) usage(4, "No Input file given\n");
 	
+	// Comparisons are printed to STDOUT by default
+	if(!outfile && oldfile && !only_check) outfile = stdout;
+	
 	// Set default outfile as infile unless --no-clobber present
 	if(!outfile && !only_check){
 		if(allow_overwrite) outfile = infile == stdin ? stdout : infile;
@@ -137,7 +263,7 @@ int main(int argc, char *argv[]){
 	if(!errfile) errfile = stderr;
 	
 	// Get content of input file and process
-	char *prog = read_file(infile);
+	char *prog = docmt_read_file(infile);
 	
 	// Parse and evaluate
 	namespace_t nmsp = nmsp_new(true);
@@ -145,12 +271,52 @@ int main(int argc, char *argv[]){
 	int errcnt = docmt_parse(doc, show_errors ? errfile : NULL);  // Parse file
 	fseek(infile, 0, SEEK_SET);  // Move `infile` back to beginning
 	
+	if(oldfile){
+		// Parse previous version and print differing results
+		char *oldprog = docmt_read_file(oldfile);
+		namespace_t oldnmsp = nmsp_new(true);
+		docmt_t olddoc = docmt_new(oldprog, oldnmsp);
+		errcnt += docmt_parse(olddoc, show_errors ? errfile : NULL);
+		
+		int diffcnt = docmt_fprint_diff(doc, olddoc, only_check ? NULL : outfile);
+		if(only_check) fprintf(errfile, "%i Differing Result%s\n", diffcnt, diffcnt == 1 ? "" : "s");
+		
+		docmt_free(olddoc);
+		nmsp_free(oldnmsp);
+		free(oldprog);
+		free(prog);
+		docmt_free(doc);
+		nmsp_free(nmsp);
+		leave(diffcnt > 0);
+	}
+	
+	// Evaluate each scenario in its own thread
+	for(size_t i = 0; i < scen_count; i++) errcnt += load_scenario(scenarios + i, nmsp, doc);
+	for(size_t i = 0; i < scen_count; i++) pthread_create(&scenarios[i].thread, NULL, run_scenario, scenarios + i);
+	
 	// Print out to new file
 	errcnt += docmt_fprint(doc,
 		only_check ? NULL : outfile,
 		show_errors ? errfile : NULL
 	);
 	
+	for(size_t i = 0; i < scen_count; i++){
+		struct scenario_s *sc = scenarios + i;
+		pthread_join(sc->thread, NULL);
+		errcnt += sc->errcnt;
+		
+		// Write out buffered document and errors
+		if(sc->out) fclose(sc->out);
+		if(sc->outbuf){
+			fprintf(outfile, "\n# Scenario: %s\n%s", sc->name, sc->outbuf);
+			free(sc->outbuf);
+		}
+		
+		fclose(sc->err);
+		if(show_errors && sc->errlen > 0) fprintf(errfile, "Scenario %s:\n%s", sc->name, sc->errbuf);
+		free(sc->errbuf);
+	}
+	
 	if(only_check){
 		// Print out number of errors
 		if(errcnt > 0) fprintf(errfile, "%i Parse Error%c\n", errcnt, errcnt > 1 ? 's' : ' ');
@@ -158,21 +324,18 @@ int main(int argc, char *argv[]){
 	}
 	
 	// Cleanup heap allocations
+	for(size_t i = 0; i < scen_count; i++){
+		struct scenario_s *sc = scenarios + i;
+		docmt_free(sc->doc);
+		docmt_free(sc->overrides);
+		nmsp_free(sc->nmsp);
+		free(sc->prog);
+	}
+	free(scenarios);
+	
 	free(prog);
 	docmt_free(doc);
 	nmsp_free(nmsp);
 	leave(0);
 }
 
-
-
-char *read_file(FILE *fl){
-	size_t len = 0, cap = 1024;  // Begin with 1024 bytes of capacity
-	char *cont = malloc(sizeof(char) * cap);
-	while((len += fread(cont + len, 1, cap - len, fl)) >= cap){  // Consume input until EOF
-		cap <<= 1;
-		cont = realloc(cont, sizeof(char) * cap);
-	}
-	return cont;
-}
-
@@ -1,16 +1,213 @@
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "arith.h"
 
 const char *arith_strerror(arith_err_t err){
 	switch(err){
 		case ARITH_ERR_OK: return "ARITH_ERR_OK: Successful";
+		case ARITH_ERR_PLACES: return "ARITH_ERR_PLACES: Number of decimal places must be a small non-negative integer";
+		case ARITH_ERR_INTEGER: return "ARITH_ERR_INTEGER: Arguments must be integers";
+		case ARITH_ERR_DOMAIN: return "ARITH_ERR_DOMAIN: Argument is outside of the function's domain";
+		case ARITH_ERR_OVERFLOW: return "ARITH_ERR_OVERFLOW: Result is too large";
 	}
 	
 	return "ARITH_ERR: Unknown Error";
 }
 
+// Powers of ten used to scale decimals
+static const long pow10s[] = {
+	1L, 10L, 100L, 1000L,
+	10000L, 100000L, 1000000L, 10000000L,
+	100000000L, 1000000000L, 10000000000L, 100000000000L,
+	1000000000000L, 10000000000000L, 100000000000000L, 1000000000000000L,
+	10000000000000000L, 100000000000000000L, 1000000000000000000L
+};
+
+// Rounding mode used by `arith_round`
+static enum arith_rounding rounding = ARITH_ROUND_HALF_EVEN;
+
+void arith_set_rounding(enum arith_rounding mode){ rounding = mode; }
+
+static arith_t arith_from(double val){
+	arith_t ar;
+	ar.type = ARITH_REAL;
+	ar.real = val;
+	return ar;
+}
+
+
+
+/*  Arbitrary Precision Integers
+ * ==============================
+ */
+// Large integer shared by every value that refers to it
+struct arith_big_s {
+	unsigned long hash;
+	double approx;  // Nearest double
+	size_t len;  // Number of limbs
+	uint32_t limbs[];  // Little endian base 2^32 digits
+};
+
+// Growable non-negative integer used while calculating
+struct bnum_s {
+	size_t len, cap;
+	uint32_t *d;
+};
+
+static void bnum_reserve(struct bnum_s *b, size_t cap){
+	if(cap <= b->cap) return;
+	b->cap = cap > 2 * b->cap ? cap : 2 * b->cap;
+	b->d = realloc(b->d, b->cap * sizeof(uint32_t));
+}
+
+static void bnum_set(struct bnum_s *b, unsigned __int128 val){
+	bnum_reserve(b, 4);
+	b->len = 0;
+	for(; val > 0; val >>= 32) b->d[b->len++] = (uint32_t)val;
+}
+
+static void bnum_init(struct bnum_s *b, unsigned __int128 val){
+	b->len = b->cap = 0;
+	b->d = NULL;
+	bnum_set(b, val);
+}
+
+static void bnum_mul_word(struct bnum_s *b, uint64_t m){
+	unsigned __int128 carry = 0;
+	for(size_t i = 0; i < b->len; i++){
+		carry += (unsigned __int128)b->d[i] * m;
+		b->d[i] = (uint32_t)carry;
+		carry >>= 32;
+	}
+	
+	bnum_reserve(b, b->len + 2);
+	for(; carry > 0; carry >>= 32) b->d[b->len++] = (uint32_t)carry;
+}
+
+// Divide in place and return the remainder
+static uint32_t bnum_div_small(struct bnum_s *b, uint32_t m){
+	uint64_t rem = 0;
+	for(size_t i = b->len; i-- > 0;){
+		uint64_t cur = (rem << 32) | b->d[i];
+		b->d[i] = (uint32_t)(cur / m);
+		rem = cur % m;
+	}
+	while(b->len > 0 && b->d[b->len - 1] == 0) b->len--;
+	return (uint32_t)rem;
+}
+
+// Set `res` to `a * b` where `res` is neither argument
+static void bnum_mul(struct bnum_s *res, const struct bnum_s *a, const struct bnum_s *b){
+	if(a->len == 0 || b->len == 0){
+		res->len = 0;
+		return;
+	}
+	
+	bnum_reserve(res, a->len + b->len);
+	memset(res->d, 0, (a->len + b->len) * sizeof(uint32_t));
+	for(size_t i = 0; i < a->len; i++){
+		uint64_t carry = 0, ai = a->d[i];
+		for(size_t j = 0; j < b->len; j++){
+			carry += ai * b->d[j] + res->d[i + j];
+			res->d[i + j] = (uint32_t)carry;
+			carry >>= 32;
+		}
+		res->d[i + b->len] = (uint32_t)carry;
+	}
+	
+	res->len = a->len + b->len;
+	while(res->len > 0 && res->d[res->len - 1] == 0) res->len--;
+}
+
+// Multiply `vals` together by splitting them into a balanced tree of products
+static void bnum_product(struct bnum_s *res, const uint64_t *vals, size_t n){
+	if(n <= 16){
+		bnum_set(res, 1);
+		for(size_t i = 0; i < n; i++) bnum_mul_word(res, vals[i]);
+		return;
+	}
+	
+	struct bnum_s lo, hi;
+	bnum_init(&lo, 0);
+	bnum_init(&hi, 0);
+	bnum_product(&lo, vals, n / 2);
+	bnum_product(&hi, vals + n / 2, n - n / 2);
+	bnum_mul(res, &lo, &hi);
+	free(lo.d);
+	free(hi.d);
+}
+
+/* Convert calculated integer into value
+ * Integers which don't fit in a ratio are copied into a new big value
+ */
+static arith_t bnum_value(const struct bnum_s *b){
+	arith_t val;
+	if(b->len <= 2){
+		uint64_t small = b->len == 0 ? 0 : b->d[0] | (b->len == 2 ? (uint64_t)b->d[1] << 32 : 0);
+		if(small <= LONG_MAX){
+			val.type = ARITH_RATIO;
+			val.num = (long)small;
+			val.den = 1;
+			return val;
+		}
+	}
+	
+	struct arith_big_s *big = malloc(sizeof(struct arith_big_s) + b->len * sizeof(uint32_t));
+	big->len = b->len;
+	memcpy(big->limbs, b->d, b->len * sizeof(uint32_t));
+	
+	// Use top three limbs for the approximation
+	size_t top = b->len < 3 ? b->len : 3;
+	big->hash = b->len;
+	big->approx = 0;
+	for(size_t i = b->len; i-- > 0;){
+		big->hash = big->hash * 0x100000001b3 ^ b->d[i];
+		if(i + top >= b->len) big->approx = big->approx * 4294967296.0 + b->d[i];
+	}
+	big->approx = ldexp(big->approx, 32 * (int)(b->len - top));
+	
+	val.type = ARITH_BIG;
+	val.big = big;
+	return val;
+}
+
+static bool big_equal(const struct arith_big_s *x, const struct arith_big_s *y){
+	return x == y || (x->len == y->len && memcmp(x->limbs, y->limbs, x->len * sizeof(uint32_t)) == 0);
+}
+
+// Remainder of big integer divided by `m`
+static uint64_t big_mod(const struct arith_big_s *big, uint64_t m){
+	unsigned __int128 rem = 0;
+	for(size_t i = big->len; i-- > 0;) rem = ((rem << 32) | big->limbs[i]) % m;
+	return (uint64_t)rem;
+}
+
+// Print in base 10 by repeatedly dividing off nine digits
+static int big_print(FILE *stream, const struct arith_big_s *big){
+	struct bnum_s b;
+	bnum_init(&b, 0);
+	bnum_reserve(&b, big->len);
+	memcpy(b.d, big->limbs, big->len * sizeof(uint32_t));
+	b.len = big->len;
+	
+	size_t count = 0;
+	uint32_t *chunks = malloc((big->len * 32 / 29 + 1) * sizeof(uint32_t));
+	while(b.len > 0) chunks[count++] = bnum_div_small(&b, 1000000000);
+	
+	int len = fprintf(stream, "%u", count ? chunks[count - 1] : 0);
+	for(size_t i = count - 1; i-- > 0;) len += fprintf(stream, "%09u", chunks[i]);
+	free(chunks);
+	free(b.d);
+	return len;
+}
+
 
 
 // Create deep copy of value, Allocating new memory
@@ -19,6 +216,34 @@ arith_t arith_clone(arith_t val){ return val; }
 // Destroy value by deallocating memory
 void arith_free(arith_t val){ return; }
 
+/* Parse decimal from `str` to `end` which has digits after the decimal point
+ * Returns true if successful
+ */
+static bool parse_dec(const char *str, const char *end, arith_t *val){
+	while(isspace(*str)) str++;
+	bool neg = *str == '-';
+	if(*str == '-' || *str == '+') str++;
+	
+	unsigned long units = 0;
+	int scale = -1;
+	for(; str < end; str++){
+		if(*str == '.' && scale < 0){
+			scale = 0;
+			continue;
+		}
+		
+		if(!isdigit(*str) || units > (LONG_MAX - 9) / 10) return false;
+		units = units * 10 + (*str - '0');
+		if(scale >= 0) scale++;
+	}
+	if(scale <= 0 || scale > ARITH_DEC_MAXSCALE) return false;
+	
+	val->type = ARITH_DEC;
+	val->units = neg ? -(long)units : (long)units;
+	val->scale = scale;
+	return true;
+}
+
 // Parse value from string
 arith_t arith_parse(const char *str, const char **endptr){
 	arith_t val;
@@ -29,7 +254,9 @@ arith_t arith_parse(const char *str, const char **endptr){
 	long i = strtol(str, (char**)&iend, 10);
 	// Try to parse as floating point
 	double r = strtod(str, (char**)&fend);
-	if(r == (double)i && iend != str){
+	if(fend != str && parse_dec(str, fend, &val)){
+		if(endptr) *endptr = fend;
+	}else if(r == (double)i && iend != str){
 		val.num = i;
 		val.den = 1;
 		val.type = ARITH_RATIO;
@@ -52,6 +279,14 @@ int arith_print(FILE *stream, arith_t val){
 			if(val.den == 0) return fprintf(stream, "1 / 0");
 			else if(val.den == 1) return fprintf(stream, "%li", val.num);
 			else return fprintf(stream, "%li / %lu", val.num, val.den);
+		case ARITH_DEC:
+			if(val.scale == 0) return fprintf(stream, "%li", val.units);
+			
+			unsigned long mag = val.units < 0 ? -(unsigned long)val.units : (unsigned long)val.units;
+			return fprintf(stream, "%s%lu.%0*lu", val.units < 0 ? "-" : "",
+				mag / pow10s[val.scale], val.scale, mag % pow10s[val.scale]
+			);
+		case ARITH_BIG: return big_print(stream, val.big);
 	}
 }
 
@@ -62,7 +297,45 @@ double arith_todbl(arith_t val){
 	switch(val.type){
 		case ARITH_REAL: return val.real;
 		case ARITH_RATIO: return (double)val.num / val.den;
+		case ARITH_DEC: return (double)val.units / pow10s[val.scale];
+		case ARITH_BIG: return val.big->approx;
+	}
+}
+
+// Compare type and value
+int arith_equal(arith_t x, arith_t y){
+	if(x.type != y.type) return 0;
+	switch(x.type){
+		case ARITH_REAL: return x.real == y.real;
+		case ARITH_RATIO: return x.num == y.num && x.den == y.den;
+		case ARITH_DEC: return x.units == y.units && x.scale == y.scale;
+		case ARITH_BIG: return big_equal(x.big, y.big);
+	}
+	return 0;
+}
+
+// Mix the fields of the value
+unsigned long arith_hash(arith_t val){
+	unsigned long h = val.type, bits;
+	switch(val.type){
+		case ARITH_REAL:
+			if(val.real == 0) val.real = 0;  // Treat -0.0 as 0.0
+			memcpy(&bits, &val.real, sizeof(double));
+			h = h * 0x100000001b3 ^ bits;
+		break;
+		case ARITH_RATIO:
+			h = h * 0x100000001b3 ^ (unsigned long)val.num;
+			h = h * 0x100000001b3 ^ val.den;
+		break;
+		case ARITH_DEC:
+			h = h * 0x100000001b3 ^ (unsigned long)val.units;
+			h = h * 0x100000001b3 ^ val.scale;
+		break;
+		case ARITH_BIG:
+			h = h * 0x100000001b3 ^ val.big->hash;
+		break;
 	}
+	return h;
 }
 
 
@@ -70,7 +343,8 @@ double arith_todbl(arith_t val){
 #define fst  (args[0])
 #define snd  (args[1])
 #define trd  (args[2])
-#define toreal(val)  ((double)(val).num / (val).den)
+#define toreal(val)  ((val).type == ARITH_DEC ? (double)(val).units / pow10s[(val).scale] : \
+	(val).type == ARITH_BIG ? (val).big->approx : (double)(val).num / (val).den)
 
 // Unary Operation Implementation(s)
 ARITH_FUNC(arith_neg){
@@ -79,6 +353,10 @@ ARITH_FUNC(arith_neg){
 		break;
 		case ARITH_RATIO: fst.num = -fst.num;
 		break;
+		case ARITH_DEC: fst.units = -fst.units;
+		break;
+		case ARITH_BIG: fst = arith_from(-fst.big->approx);
+		break;
 	}
 	return fst;
 }
@@ -86,7 +364,7 @@ ARITH_FUNC(arith_neg){
 // Combine small integers together
 #define both(x, y) (((x) << 4) | (y))
 
-static void simplify(arith_t *val){
+void arith_simplify(arith_t *val){
 	if(val->type != ARITH_RATIO) return;
 	if(val->num == 0){
 		val->den = 1;
@@ -117,8 +395,187 @@ static void simplify(arith_t *val){
 	val->den /= b;
 }
 
+
+
+/* Convert big and decimal arguments of mixed operation to a common type
+ * Any remaining mix of Real and Ratio is handled by each operation
+ */
+static inline void promote(arith_t *x, arith_t *y){
+	if(x->type == ARITH_BIG) *x = arith_from(x->big->approx);
+	if(y->type == ARITH_BIG) *y = arith_from(y->big->approx);
+	if(x->type == y->type || (x->type != ARITH_DEC && y->type != ARITH_DEC)) return;
+	
+	arith_t *dec = x->type == ARITH_DEC ? x : y;
+	arith_t *oth = x->type == ARITH_DEC ? y : x;
+	if(oth->type == ARITH_REAL){
+		*dec = arith_from(toreal(*dec));
+	}else if(oth->den == 1){  // Integers become decimals
+		long num = oth->num;
+		oth->type = ARITH_DEC;
+		oth->units = num;
+		oth->scale = 0;
+	}else{  // Otherwise decimal becomes ratio
+		long units = dec->units;
+		unsigned long den = pow10s[dec->scale];
+		dec->type = ARITH_RATIO;
+		dec->num = units;
+		dec->den = den;
+		arith_simplify(dec);
+	}
+}
+
+/* Divide `num` by `den` rounding using the current rounding mode
+ * Returns true if the quotient doesn't fit in `quot`
+ */
+static bool round_div(__int128 num, __int128 den, long *quot){
+	if(den < 0){
+		num = -num;
+		den = -den;
+	}
+	
+	__int128 q = num / den, r = num % den;
+	int sign = num < 0 ? -1 : 1;
+	if(r < 0) r = -r;
+	if(r != 0) switch(rounding){
+		case ARITH_ROUND_HALF_EVEN:
+			if(2 * r > den || (2 * r == den && (q & 1))) q += sign;
+		break;
+		case ARITH_ROUND_HALF_UP:
+			if(2 * r >= den) q += sign;
+		break;
+		case ARITH_ROUND_DOWN: break;
+		case ARITH_ROUND_UP: q += sign;
+		break;
+		case ARITH_ROUND_FLOOR: if(num < 0) q--;
+		break;
+		case ARITH_ROUND_CEIL: if(num > 0) q++;
+		break;
+	}
+	
+	if(q > LONG_MAX || q < LONG_MIN) return true;
+	*quot = (long)q;
+	return false;
+}
+
+// Round real to an integer using the current rounding mode
+static double round_real(double x){
+	switch(rounding){
+		case ARITH_ROUND_HALF_EVEN: return nearbyint(x);
+		case ARITH_ROUND_HALF_UP: return round(x);
+		case ARITH_ROUND_DOWN: return trunc(x);
+		case ARITH_ROUND_UP: return x < 0 ? floor(x) : ceil(x);
+		case ARITH_ROUND_FLOOR: return floor(x);
+		case ARITH_ROUND_CEIL: return ceil(x);
+	}
+	return x;
+}
+
+/* Bring two decimals to the same scale
+ * Returns true, leaving both unchanged, if they don't fit
+ */
+static inline bool dec_align(arith_t *x, arith_t *y){
+	if(x->scale == y->scale) return false;
+	
+	arith_t *lo = x->scale < y->scale ? x : y;
+	int scale = x->scale < y->scale ? y->scale : x->scale;
+	long units;
+	if(__builtin_mul_overflow(lo->units, pow10s[scale - lo->scale], &units)) return true;
+	lo->units = units;
+	lo->scale = scale;
+	return false;
+}
+
+static arith_t dec_add(arith_t x, arith_t y){
+	long units;
+	if(dec_align(&x, &y) || __builtin_add_overflow(x.units, y.units, &units))
+		return arith_from(toreal(x) + toreal(y));
+	x.units = units;
+	return x;
+}
+
+static arith_t dec_sub(arith_t x, arith_t y){
+	long units;
+	if(dec_align(&x, &y) || __builtin_sub_overflow(x.units, y.units, &units))
+		return arith_from(toreal(x) - toreal(y));
+	x.units = units;
+	return x;
+}
+
+static arith_t dec_mul(arith_t x, arith_t y){
+	__int128 units = (__int128)x.units * y.units;
+	int scale = x.scale + y.scale;
+	// Drop trailing zeros beyond the largest scale
+	for(; scale > ARITH_DEC_MAXSCALE && units % 10 == 0; scale--) units /= 10;
+	
+	if(scale > ARITH_DEC_MAXSCALE || units > LONG_MAX || units < LONG_MIN)
+		return arith_from(toreal(x) * toreal(y));
+	x.units = (long)units;
+	x.scale = scale;
+	return x;
+}
+
+// Quotient has the larger scale of the two, or more if needed to be exact
+static arith_t dec_div(arith_t x, arith_t y){
+	int scale = x.scale > y.scale ? x.scale : y.scale;
+	if(y.units == 0) return arith_from(toreal(x) / toreal(y));
+	
+	// Divide at largest scale then remove extra zeros
+	__int128 units = (__int128)x.units * pow10s[ARITH_DEC_MAXSCALE - x.scale + y.scale];
+	if(units % y.units) return arith_from(toreal(x) / toreal(y));
+	units /= y.units;
+	
+	int extra = ARITH_DEC_MAXSCALE - scale;
+	for(; extra > 0 && units % 10 == 0; extra--) units /= 10;
+	if(units > LONG_MAX || units < LONG_MIN) return arith_from(toreal(x) / toreal(y));
+	
+	x.units = (long)units;
+	x.scale = scale + extra;
+	return x;
+}
+
+static arith_t dec_mod(arith_t x, arith_t y){
+	if(dec_align(&x, &y) || y.units == 0) return arith_from(fmod(toreal(x), toreal(y)));
+	x.units %= y.units;
+	return x;
+}
+
+// Floor of quotient as an integer ratio
+static long dec_flrdiv(arith_t x, arith_t y){
+	if(dec_align(&x, &y) || y.units == 0) return (long)floor(toreal(x) / toreal(y));
+	
+	long q = x.units / y.units;
+	if(x.units % y.units != 0 && (x.units < 0) != (y.units < 0)) q--;
+	return q;
+}
+
+// Exact power when exponent is an integer
+static arith_t dec_pow(arith_t x, arith_t y){
+	if(y.units % pow10s[y.scale]) return arith_from(pow(toreal(x), toreal(y)));
+	long n = y.units / pow10s[y.scale];
+	
+	arith_t res = x, step = x;
+	res.units = 1;
+	res.scale = 0;
+	unsigned long e = n < 0 ? -(unsigned long)n : (unsigned long)n;
+	while(e > 0 && res.type == ARITH_DEC && step.type == ARITH_DEC){
+		if(e & 1) res = dec_mul(res, step);
+		e >>= 1;
+		if(e) step = dec_mul(step, step);
+	}
+	
+	if(e > 0 || res.type != ARITH_DEC) return arith_from(pow(toreal(x), toreal(y)));
+	if(n < 0){
+		step = res;
+		step.units = 1;
+		step.scale = 0;
+		res = dec_div(step, res);
+	}
+	return res;
+}
+
 // Binary Operation Implementation(s)
 ARITH_FUNC(arith_add){
+	promote(&fst, &snd);
 	switch(both(fst.type, snd.type)){
 		case both(ARITH_REAL, ARITH_REAL):
 			fst.real += snd.real;
@@ -134,13 +591,17 @@ ARITH_FUNC(arith_add){
 			fst.num *= snd.den;
 			fst.num += snd.num * (long)fst.den;
 			fst.den *= snd.den;
-			simplify(&fst);
+			arith_simplify(&fst);
+		break;
+		case both(ARITH_DEC, ARITH_DEC):
+			fst = dec_add(fst, snd);
 		break;
 	}
 	return fst;
 }
 
 ARITH_FUNC(arith_sub){
+	promote(&fst, &snd);
 	switch(both(fst.type, snd.type)){
 		case both(ARITH_REAL, ARITH_REAL):
 			fst.real -= snd.real;
@@ -156,13 +617,17 @@ ARITH_FUNC(arith_sub){
 			fst.num *= snd.den;
 			fst.num -= snd.num * (long)fst.den;
 			fst.den *= snd.den;
-			simplify(&fst);
+			arith_simplify(&fst);
+		break;
+		case both(ARITH_DEC, ARITH_DEC):
+			fst = dec_sub(fst, snd);
 		break;
 	}
 	return fst;
 }
 
 ARITH_FUNC(arith_mul){
+	promote(&fst, &snd);
 	switch(both(fst.type, snd.type)){
 		case both(ARITH_REAL, ARITH_REAL):
 			fst.real *= snd.real;
@@ -178,13 +643,17 @@ ARITH_FUNC(arith_mul){
 		case both(ARITH_RATIO, ARITH_RATIO):
 			fst.num *= snd.num;
 			fst.den *= snd.den;
-			simplify(&fst);
+			arith_simplify(&fst);
+		break;
+		case both(ARITH_DEC, ARITH_DEC):
+			fst = dec_mul(fst, snd);
 		break;
 	}
 	return fst;
 }
 
 ARITH_FUNC(arith_div){
+	promote(&fst, &snd);
 	switch(both(fst.type, snd.type)){
 		case both(ARITH_REAL, ARITH_REAL):
 			fst.real /= snd.real;
@@ -203,13 +672,17 @@ ARITH_FUNC(arith_div){
 				fst.num = -fst.num;
 				fst.den *= (unsigned long)(-snd.num);
 			}else fst.den *= (unsigned long)(snd.num);
-			simplify(&fst);
+			arith_simplify(&fst);
+		break;
+		case both(ARITH_DEC, ARITH_DEC):
+			fst = dec_div(fst, snd);
 		break;
 	}
 	return fst;
 }
 
 ARITH_FUNC(arith_flrdiv){
+	promote(&fst, &snd);
 	switch(both(fst.type, snd.type)){
 		case both(ARITH_REAL, ARITH_REAL):
 			fst.num = (long)floor(fst.real / snd.real);
@@ -225,6 +698,9 @@ ARITH_FUNC(arith_flrdiv){
 		case both(ARITH_RATIO, ARITH_RATIO):
 			fst.num = (long)floor((double)fst.num * snd.den / fst.den / snd.num);
 		break;
+		case both(ARITH_DEC, ARITH_DEC):
+			fst.num = dec_flrdiv(fst, snd);
+		break;
 	}
 	
 	fst.type = ARITH_RATIO;
@@ -233,6 +709,14 @@ ARITH_FUNC(arith_flrdiv){
 }
 
 ARITH_FUNC(arith_mod){
+	// Remainder of big integer is exact
+	if(fst.type == ARITH_BIG && snd.type == ARITH_RATIO && snd.den == 1 && snd.num != 0){
+		uint64_t m = snd.num < 0 ? -(uint64_t)snd.num : (uint64_t)snd.num;
+		snd.num = big_mod(fst.big, m);
+		return snd;
+	}
+	
+	promote(&fst, &snd);
 	switch(both(fst.type, snd.type)){
 		case both(ARITH_REAL, ARITH_REAL):
 			fst.real = fmod(fst.real, snd.real);
@@ -249,7 +733,10 @@ ARITH_FUNC(arith_mod){
 
 			fst.num %= snd.num * (long)fst.den;
 			fst.den *= snd.den;
-			simplify(&fst);
+			arith_simplify(&fst);
+		break;
+		case both(ARITH_DEC, ARITH_DEC):
+			fst = dec_mod(fst, snd);
 		break;
 	}
 	return fst;
@@ -288,6 +775,7 @@ static arith_t int_pow(arith_t val, int pow){
 }
 
 ARITH_FUNC(arith_pow){
+	promote(&fst, &snd);
 	switch(both(fst.type, snd.type)){
 		case both(ARITH_REAL, ARITH_REAL):
 			fst.real = pow(fst.real, snd.real);
@@ -307,6 +795,9 @@ ARITH_FUNC(arith_pow){
 				fst.type = ARITH_REAL;
 			}
 		break;
+		case both(ARITH_DEC, ARITH_DEC):
+			fst = dec_pow(fst, snd);
+		break;
 	}
 	return fst;
 }
@@ -321,11 +812,16 @@ ARITH_FUNC(arith_abs){
 		case ARITH_RATIO:
 			if(fst.num < 0) fst.num = -fst.num;
 		break;
+		case ARITH_DEC:
+			if(fst.units < 0) fst.units = -fst.units;
+		break;
+		case ARITH_BIG: break;  // Always non-negative
 	}
 	return fst;
 }
 
 ARITH_FUNC(arith_floor){
+	if(fst.type == ARITH_BIG) return fst;  // Already a non-negative integer
 	switch(fst.type){
 		case ARITH_REAL:
 			fst.num = floor(fst.real);
@@ -333,6 +829,10 @@ ARITH_FUNC(arith_floor){
 		case ARITH_RATIO:
 			fst.num = (long)floor(toreal(fst));
 		break;
+		case ARITH_DEC:{
+			long p = pow10s[fst.scale], q = fst.units / p;
+			fst.num = q - (fst.units % p < 0);
+		}break;
 	}
 	fst.den = 1;
 	fst.type = ARITH_RATIO;
@@ -340,6 +840,7 @@ ARITH_FUNC(arith_floor){
 }
 
 ARITH_FUNC(arith_ceil){
+	if(fst.type == ARITH_BIG) return fst;  // Already a non-negative integer
 	switch(fst.type){
 		case ARITH_REAL:
 			fst.num = ceil(fst.real);
@@ -347,18 +848,71 @@ ARITH_FUNC(arith_ceil){
 		case ARITH_RATIO:
 			fst.num = (long)ceil(toreal(fst));
 		break;
+		case ARITH_DEC:{
+			long p = pow10s[fst.scale], q = fst.units / p;
+			fst.num = q + (fst.units % p > 0);
+		}break;
 	}
 	fst.den = 1;
 	fst.type = ARITH_RATIO;
 	return fst;
 }
 
+ARITH_FUNC(arith_round){
+	// Number of places must be a small non-negative integer
+	long places = -1;
+	switch(snd.type){
+		case ARITH_REAL:
+			if(snd.real == floor(snd.real) && snd.real >= 0 && snd.real <= ARITH_DEC_MAXSCALE) places = snd.real;
+		break;
+		case ARITH_RATIO:
+			if(snd.den == 1) places = snd.num;
+		break;
+		case ARITH_DEC:
+			if(snd.units % pow10s[snd.scale] == 0) places = snd.units / pow10s[snd.scale];
+		break;
+	}
+	if(places < 0 || places > ARITH_DEC_MAXSCALE){
+		*errp = ARITH_ERR_PLACES;
+		return fst;
+	}
+	
+	long units;
+	bool over = true;
+	switch(fst.type){
+		case ARITH_REAL: break;
+		case ARITH_BIG: return fst;
+		case ARITH_RATIO:
+			if(fst.den == 0) return fst;
+			over = round_div((__int128)fst.num * pow10s[places], fst.den, &units);
+		break;
+		case ARITH_DEC:
+			if(places >= fst.scale)
+				over = __builtin_mul_overflow(fst.units, pow10s[places - fst.scale], &units);
+			else over = round_div(fst.units, pow10s[fst.scale - places], &units);
+		break;
+	}
+	
+	if(over){  // Round as real when exact value isn't available
+		double r = round_real(arith_todbl(fst) * pow10s[places]);
+		if(!(fabs(r) < 9e18)) return arith_from(r / pow10s[places]);
+		units = (long)r;
+	}
+	
+	fst.type = ARITH_DEC;
+	fst.units = units;
+	fst.scale = places;
+	return fst;
+}
+
 ARITH_FUNC(arith_sqrt){
 	switch(fst.type){
 		case ARITH_REAL:
 			fst.real = sqrt(fst.real);
 		break;
 		case ARITH_RATIO:
+		case ARITH_DEC:
+		case ARITH_BIG:
 			fst.real = sqrt(toreal(fst));
 			fst.type = ARITH_REAL;
 		break;
@@ -367,6 +921,7 @@ ARITH_FUNC(arith_sqrt){
 }
 
 ARITH_FUNC(arith_log){
+	promote(&fst, &snd);
 	switch(both(fst.type, snd.type)){
 		case both(ARITH_REAL, ARITH_REAL):
 			fst.real = log(fst.real) / log(snd.real);
@@ -379,6 +934,7 @@ ARITH_FUNC(arith_log){
 			fst.type = ARITH_REAL;
 		break;
 		case both(ARITH_RATIO, ARITH_RATIO):
+		case both(ARITH_DEC, ARITH_DEC):
 			fst.real = log(toreal(fst)) / log(toreal(snd));
 			fst.type = ARITH_REAL;
 		break;
@@ -392,6 +948,8 @@ ARITH_FUNC(arith_ln){
 			fst.real = log(fst.real);
 		break;
 		case ARITH_RATIO:
+		case ARITH_DEC:
+		case ARITH_BIG:
 			fst.real = log(toreal(fst));
 			fst.type = ARITH_REAL;
 		break;
@@ -405,6 +963,8 @@ ARITH_FUNC(arith_sin){
 			fst.real = sin(fst.real);
 		break;
 		case ARITH_RATIO:
+		case ARITH_DEC:
+		case ARITH_BIG:
 			fst.real = sin(toreal(fst));
 			fst.type = ARITH_REAL;
 		break;
@@ -418,6 +978,8 @@ ARITH_FUNC(arith_cos){
 			fst.real = cos(fst.real);
 		break;
 		case ARITH_RATIO:
+		case ARITH_DEC:
+		case ARITH_BIG:
 			fst.real = cos(toreal(fst));
 			fst.type = ARITH_REAL;
 		break;
@@ -431,6 +993,8 @@ ARITH_FUNC(arith_tan){
 			fst.real = tan(fst.real);
 		break;
 		case ARITH_RATIO:
+		case ARITH_DEC:
+		case ARITH_BIG:
 			fst.real = tan(toreal(fst));
 			fst.type = ARITH_REAL;
 		break;
@@ -439,14 +1003,540 @@ ARITH_FUNC(arith_tan){
 }
 
 
-// Constants
-static arith_t arith_from(double val){
+
+/*  Number Theory Functions
+ * =========================
+ */
+static arith_t arith_int(long val){
 	arith_t ar;
-	ar.type = ARITH_REAL;
-	ar.real = val;
+	ar.type = ARITH_RATIO;
+	ar.num = val;
+	ar.den = 1;
 	return ar;
 }
 
+/* Get the value of an integer argument
+ * Returns true if the value is not an integer
+ */
+static bool get_int(arith_t val, long *ip){
+	switch(val.type){
+		case ARITH_REAL:
+			if(val.real != floor(val.real) || !(fabs(val.real) < 9e18)) return true;
+			*ip = (long)val.real;
+		break;
+		case ARITH_RATIO:
+			if(val.den != 1) return true;
+			*ip = val.num;
+		break;
+		case ARITH_DEC:
+			if(val.units % pow10s[val.scale]) return true;
+			*ip = val.units / pow10s[val.scale];
+		break;
+		case ARITH_BIG: return true;
+	}
+	return false;
+}
+
+#define get_ints(n) \
+	long ints[n]; \
+	for(int i = 0; i < (n); i++) if(get_int(args[i], ints + i)){ \
+		*errp = ARITH_ERR_INTEGER; \
+		return fst; \
+	}
+
+// Binary GCD algorithm
+static unsigned long gcd(unsigned long a, unsigned long b){
+	if(a == 0) return b;
+	if(b == 0) return a;
+	
+	int shift = __builtin_ctzl(a | b);
+	a >>= __builtin_ctzl(a);
+	do{
+		b >>= __builtin_ctzl(b);
+		if(a > b){
+			unsigned long tmp = a;
+			a = b;
+			b = tmp;
+		}
+		b -= a;
+	}while(b != 0);
+	return a << shift;
+}
+
+/* Montgomery form of arithmetic modulo odd `m` with R = 2^64
+ * Values are stored as `x * R mod m` so multiplication
+ * needs no division
+ */
+struct mont_s {
+	unsigned long m;
+	unsigned long minv;  // -m^-1 mod R
+	unsigned long one;  // R mod m
+	unsigned long r2;  // R^2 mod m
+};
+
+static void mont_init(struct mont_s *mt, unsigned long m){
+	mt->m = m;
+	// Newton's iteration doubles the number of correct bits each step
+	unsigned long inv = m;
+	for(int i = 0; i < 5; i++) inv *= 2 - m * inv;
+	mt->minv = -inv;
+	mt->one = (unsigned long)(((unsigned __int128)1 << 64) % m);
+	mt->r2 = (unsigned long)(((unsigned __int128)mt->one << 64) % m);
+}
+
+static inline unsigned long mont_mul(const struct mont_s *mt, unsigned long a, unsigned long b){
+	unsigned __int128 t = (unsigned __int128)a * b;
+	unsigned long u = (unsigned long)t * mt->minv;
+	unsigned long res = (t + (unsigned __int128)u * mt->m) >> 64;
+	return res >= mt->m ? res - mt->m : res;
+}
+
+// Convert `a < m` to Montgomery form
+static inline unsigned long mont_to(const struct mont_s *mt, unsigned long a){
+	return mont_mul(mt, a, mt->r2);
+}
+
+static inline unsigned long mont_from(const struct mont_s *mt, unsigned long a){
+	return mont_mul(mt, a, 1);
+}
+
+// Power in Montgomery form
+static unsigned long mont_pow(const struct mont_s *mt, unsigned long base, unsigned long exp){
+	unsigned long res = mt->one;
+	while(exp > 0){
+		if(exp & 1) res = mont_mul(mt, res, base);
+		base = mont_mul(mt, base, base);
+		exp >>= 1;
+	}
+	return res;
+}
+
+// Calculate `base ^ exp mod m` where `base < m`
+static unsigned long pow_mod(unsigned long base, unsigned long exp, unsigned long m){
+	if(m == 1) return 0;
+	if(m & 1){
+		struct mont_s mt;
+		mont_init(&mt, m);
+		return mont_from(&mt, mont_pow(&mt, mont_to(&mt, base), exp));
+	}
+	
+	// Even modulus uses 128-bit remainders
+	unsigned long res = 1;
+	while(exp > 0){
+		if(exp & 1) res = (unsigned __int128)res * base % m;
+		base = (unsigned __int128)base * base % m;
+		exp >>= 1;
+	}
+	return res;
+}
+
+/* Inverse of `a` modulo `m` by the extended Euclidean algorithm
+ * Returns 0 if there is no inverse
+ */
+static unsigned long inv_mod(unsigned long a, unsigned long m){
+	long t = 0, newt = 1;
+	unsigned long r = m, newr = a % m;
+	while(newr != 0){
+		unsigned long q = r / newr, tmp = r - q * newr;
+		r = newr;
+		newr = tmp;
+		
+		long tt = t - (long)q * newt;
+		t = newt;
+		newt = tt;
+	}
+	
+	if(r != 1) return 0;
+	return t < 0 ? (unsigned long)(t + (long)m) : (unsigned long)t;
+}
+
+// Deterministic Miller-Rabin test for 64-bit integers
+static bool is_prime(unsigned long n){
+	static const unsigned long primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+	// Set of bases which finds every composite below 2^64
+	static const unsigned long bases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+	if(n < 2) return false;
+	for(int i = 0; i < 12; i++){
+		if(n == primes[i]) return true;
+		if(n % primes[i] == 0) return false;
+	}
+	if(n < 37 * 37) return true;
+	
+	// Write n - 1 = d * 2^s
+	int s = __builtin_ctzl(n - 1);
+	unsigned long d = (n - 1) >> s;
+	
+	struct mont_s mt;
+	mont_init(&mt, n);
+	unsigned long minus_one = n - mt.one;
+	for(int i = 0; i < 7; i++){
+		unsigned long a = bases[i] % n;
+		if(a == 0) continue;
+		
+		unsigned long x = mont_pow(&mt, mont_to(&mt, a), d);
+		if(x == mt.one || x == minus_one) continue;
+		
+		int j = 1;
+		for(; j < s; j++){
+			x = mont_mul(&mt, x, x);
+			if(x == minus_one) break;
+		}
+		if(j >= s) return false;
+	}
+	return true;
+}
+
+ARITH_FUNC(arith_gcd){
+	get_ints(2);
+	unsigned long a = ints[0] < 0 ? -(unsigned long)ints[0] : (unsigned long)ints[0];
+	unsigned long b = ints[1] < 0 ? -(unsigned long)ints[1] : (unsigned long)ints[1];
+	return arith_int(gcd(a, b));
+}
+
+ARITH_FUNC(arith_lcm){
+	get_ints(2);
+	unsigned long a = ints[0] < 0 ? -(unsigned long)ints[0] : (unsigned long)ints[0];
+	unsigned long b = ints[1] < 0 ? -(unsigned long)ints[1] : (unsigned long)ints[1];
+	if(a == 0 || b == 0) return arith_int(0);
+	
+	// Give real when the multiple doesn't fit
+	long res;
+	if(__builtin_mul_overflow((long)(a / gcd(a, b)), (long)b, &res)) return arith_from((double)(a / gcd(a, b)) * b);
+	return arith_int(res);
+}
+
+ARITH_FUNC(arith_powmod){
+	get_ints(3);
+	if(ints[2] <= 0){
+		*errp = ARITH_ERR_DOMAIN;
+		return fst;
+	}else if(ints[2] == 1) return arith_int(0);
+	
+	unsigned long m = ints[2], base = ints[0] < 0 ? ints[0] % ints[2] + ints[2] : ints[0] % ints[2];
+	unsigned long exp = ints[1] < 0 ? -(unsigned long)ints[1] : (unsigned long)ints[1];
+	// Negative powers use the inverse
+	if(ints[1] < 0 && !(base = inv_mod(base, m))){
+		*errp = ARITH_ERR_DOMAIN;
+		return fst;
+	}
+	return arith_int(pow_mod(base % m, exp, m));
+}
+
+ARITH_FUNC(arith_modinv){
+	get_ints(2);
+	if(ints[1] <= 0){
+		*errp = ARITH_ERR_DOMAIN;
+		return fst;
+	}else if(ints[1] == 1) return arith_int(0);
+	
+	unsigned long m = ints[1], a = ints[0] < 0 ? ints[0] % ints[1] + ints[1] : ints[0] % ints[1];
+	unsigned long inv = inv_mod(a, m);
+	if(!inv){
+		*errp = ARITH_ERR_DOMAIN;
+		return fst;
+	}
+	return arith_int(inv);
+}
+
+ARITH_FUNC(arith_isprime){
+	get_ints(1);
+	return arith_int(ints[0] > 0 && is_prime(ints[0]));
+}
+
+
+/*  Combinatorial Functions
+ * =========================
+ */
+// Largest result in bits that combinatorial functions will calculate
+#define COMB_MAXBITS (1 << 17)
+
+// Factorials which fit in a ratio
+static const long small_facts[21] = {
+	1L, 1L, 2L, 6L, 24L, 120L, 720L, 5040L, 40320L, 362880L, 3628800L,
+	39916800L, 479001600L, 6227020800L, 87178291200L, 1307674368000L,
+	20922789888000L, 355687428096000L, 6402373705728000L,
+	121645100408832000L, 2432902008176640000L
+};
+
+// Left half of the rows of Pascal's triangle which fit in a ratio
+#define PASCAL_ROWS (67)
+static long pascal[PASCAL_ROWS][PASCAL_ROWS / 2 + 1];
+static pthread_once_t pascal_once = PTHREAD_ONCE_INIT;
+
+static void pascal_init(){
+	for(int n = 0; n < PASCAL_ROWS; n++){
+		pascal[n][0] = 1;
+		for(int k = 1; k <= n / 2; k++){
+			// Entries past the middle are mirrored
+			long right = 2 * k <= n - 1 ? pascal[n - 1][k] : pascal[n - 1][n - 1 - k];
+			pascal[n][k] = pascal[n - 1][k - 1] + right;
+		}
+	}
+}
+
+// Largest `n` for which binomials with large `k` are calculated from prime powers
+#define BINOM_SIEVE_MAX (1UL << 22)
+
+// Approximate log2(n!) using Stirling's formula
+static double log2_fact(double n){
+	if(n < 2) return 0;
+	return (n * log(n) - n + 0.5 * log(6.283185307179586 * n)) / M_LN2;
+}
+
+// Approximate number of bits in n! / (n - k)!
+static double log2_falling(unsigned long n, unsigned long k){
+	// Difference of large logarithms loses too much precision
+	if(n < (1UL << 40)) return log2_fact(n) - log2_fact(n - k);
+	return k * log2((double)n);
+}
+
+/* Cache of results for arguments beyond the tables
+ * Shared by all threads and kept for the life of the process
+ */
+enum comb_func {
+	COMB_FACTORIAL = 1,
+	COMB_BINOM,
+	COMB_PERM
+};
+
+struct comb_memo_s {
+	enum comb_func func;  // Zero when slot is empty
+	unsigned long n, k;
+	arith_t value;
+};
+
+static pthread_mutex_t memo_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t memo_count = 0, memo_cap = 0;
+static struct comb_memo_s *memo = NULL;
+
+// Find slot for arguments by linear probing, `memo_lock` must be held
+static struct comb_memo_s *memo_slot(enum comb_func func, unsigned long n, unsigned long k){
+	unsigned long h = (n * 0x9e3779b97f4a7c15 ^ k) * 0xbf58476d1ce4e5b9 ^ func;
+	h ^= h >> 31;
+	
+	struct comb_memo_s *slot = memo + (h & (memo_cap - 1));
+	while(slot->func && (slot->func != func || slot->n != n || slot->k != k)){
+		if(++slot >= memo + memo_cap) slot = memo;
+	}
+	return slot;
+}
+
+static bool memo_get(enum comb_func func, unsigned long n, unsigned long k, arith_t *valp){
+	pthread_mutex_lock(&memo_lock);
+	struct comb_memo_s *slot = memo_cap ? memo_slot(func, n, k) : NULL;
+	bool found = slot && slot->func;
+	if(found) *valp = slot->value;
+	pthread_mutex_unlock(&memo_lock);
+	return found;
+}
+
+/* Store result and return the cached value
+ * A result stored by another thread in the meantime is preferred
+ */
+static arith_t memo_put(enum comb_func func, unsigned long n, unsigned long k, arith_t val){
+	pthread_mutex_lock(&memo_lock);
+	// Keep table at most half full
+	if(2 * (memo_count + 1) > memo_cap){
+		struct comb_memo_s *old = memo;
+		size_t oldcap = memo_cap;
+		memo_cap = memo_cap ? 2 * memo_cap : 64;
+		memo = calloc(memo_cap, sizeof(struct comb_memo_s));
+		for(size_t i = 0; i < oldcap; i++){
+			if(old[i].func) *memo_slot(old[i].func, old[i].n, old[i].k) = old[i];
+		}
+		free(old);
+	}
+	
+	struct comb_memo_s *slot = memo_slot(func, n, k);
+	if(slot->func){
+		if(val.type == ARITH_BIG) free((void*)val.big);
+		val = slot->value;
+	}else{
+		slot->func = func;
+		slot->n = n;
+		slot->k = k;
+		slot->value = val;
+		memo_count++;
+	}
+	pthread_mutex_unlock(&memo_lock);
+	return val;
+}
+
+// List the primes up to `n` using the sieve of Eratosthenes
+static uint64_t *sieve(unsigned long n, size_t *countp){
+	char *composite = calloc(n + 1, 1);
+	uint64_t *primes = malloc((n / 2 + 1) * sizeof(uint64_t));
+	size_t count = 0;
+	for(unsigned long p = 2; p <= n; p++){
+		if(composite[p]) continue;
+		primes[count++] = p;
+		for(unsigned long q = p * p; q <= n; q += p) composite[q] = 1;
+	}
+	
+	free(composite);
+	*countp = count;
+	return primes;
+}
+
+/* Calculate n! by the prime swing algorithm
+ *   n! = ((n / 2)!)^2 * swing(n)
+ * where swing(n) is a product of small prime powers
+ */
+static void bnum_factorial(struct bnum_s *res, unsigned long n, const uint64_t *primes, size_t nprimes, uint64_t *buf){
+	if(n < 21){
+		bnum_set(res, small_facts[n]);
+		return;
+	}
+	
+	struct bnum_s half, swing;
+	bnum_init(&half, 0);
+	bnum_init(&swing, 0);
+	bnum_factorial(&half, n / 2, primes, nprimes, buf);
+	
+	// Prime p divides swing(n) once for each odd floor(n / p^i)
+	size_t count = 0;
+	for(size_t i = 0; i < nprimes && primes[i] <= n; i++){
+		unsigned long q = n, pe = 1;
+		while((q /= primes[i]) > 0) if(q & 1) pe *= primes[i];
+		if(pe > 1) buf[count++] = pe;
+	}
+	bnum_product(&swing, buf, count);
+	
+	bnum_mul(res, &half, &half);
+	bnum_mul(&half, res, &swing);
+	struct bnum_s tmp = *res;
+	*res = half;
+	free(tmp.d);
+	free(swing.d);
+}
+
+ARITH_FUNC(arith_factorial){
+	get_ints(1);
+	if(ints[0] < 0){
+		*errp = ARITH_ERR_DOMAIN;
+		return fst;
+	}
+	
+	unsigned long n = ints[0];
+	if(n < 21) return arith_int(small_facts[n]);
+	if(memo_get(COMB_FACTORIAL, n, 0, &fst)) return fst;
+	if(log2_fact(n) > COMB_MAXBITS){
+		*errp = ARITH_ERR_OVERFLOW;
+		return fst;
+	}
+	
+	size_t nprimes;
+	uint64_t *primes = sieve(n, &nprimes);
+	uint64_t *buf = malloc(nprimes * sizeof(uint64_t));
+	struct bnum_s res;
+	bnum_init(&res, 0);
+	bnum_factorial(&res, n, primes, nprimes, buf);
+	fst = bnum_value(&res);
+	
+	free(res.d);
+	free(buf);
+	free(primes);
+	return memo_put(COMB_FACTORIAL, n, 0, fst);
+}
+
+ARITH_FUNC(arith_binom){
+	get_ints(2);
+	if(ints[0] < 0){
+		*errp = ARITH_ERR_DOMAIN;
+		return fst;
+	}else if(ints[1] < 0 || ints[1] > ints[0]) return arith_int(0);
+	
+	unsigned long n = ints[0], k = ints[1];
+	if(k > n - k) k = n - k;
+	if(n < PASCAL_ROWS){
+		pthread_once(&pascal_once, pascal_init);
+		return arith_int(pascal[n][k]);
+	}
+	if(memo_get(COMB_BINOM, n, k, &fst)) return fst;
+	if(log2_falling(n, k) - log2_fact(k) > COMB_MAXBITS){
+		*errp = ARITH_ERR_OVERFLOW;
+		return fst;
+	}
+	
+	struct bnum_s res;
+	if(k > 64 && n <= BINOM_SIEVE_MAX){
+		// Power of prime p is the number of floor(n / p^i) with a carry
+		size_t nprimes, count = 0;
+		uint64_t *primes = sieve(n, &nprimes);
+		for(size_t j = 0; j < nprimes; j++){
+			unsigned long p = primes[j], a = n, b = k, c = n - k, pe = 1;
+			while(a >= p){
+				a /= p;
+				b /= p;
+				c /= p;
+				if(a != b + c) pe *= p;
+			}
+			if(pe > 1) primes[count++] = pe;
+		}
+		
+		bnum_init(&res, 0);
+		bnum_product(&res, primes, count);
+		fst = bnum_value(&res);
+		
+		free(res.d);
+		free(primes);
+		return memo_put(COMB_BINOM, n, k, fst);
+	}
+	
+	/* Multiply then divide at every step so that the
+	 * result is binom(n - k + i, i) after step i
+	 */
+	unsigned __int128 small = 1;
+	unsigned long i = 1;
+	for(; i <= k && small <= LONG_MAX; i++) small = small * (n - k + i) / i;
+	
+	bnum_init(&res, small);
+	while(i <= k){
+		// Combine steps while their products fit in words
+		uint64_t num = n - k + i, den = i++;
+		for(; i <= k && num <= UINT64_MAX / (n - k + i) && den <= UINT32_MAX / i; i++){
+			num *= n - k + i;
+			den *= i;
+		}
+		bnum_mul_word(&res, num);
+		bnum_div_small(&res, (uint32_t)den);
+	}
+	fst = bnum_value(&res);
+	
+	free(res.d);
+	return memo_put(COMB_BINOM, n, k, fst);
+}
+
+ARITH_FUNC(arith_perm){
+	get_ints(2);
+	if(ints[0] < 0){
+		*errp = ARITH_ERR_DOMAIN;
+		return fst;
+	}else if(ints[1] < 0 || ints[1] > ints[0]) return arith_int(0);
+	
+	unsigned long n = ints[0], k = ints[1];
+	if(n < 21) return arith_int(small_facts[n] / small_facts[n - k]);
+	if(memo_get(COMB_PERM, n, k, &fst)) return fst;
+	if(log2_falling(n, k) > COMB_MAXBITS){
+		*errp = ARITH_ERR_OVERFLOW;
+		return fst;
+	}
+	
+	uint64_t *vals = malloc(k * sizeof(uint64_t));
+	for(unsigned long i = 0; i < k; i++) vals[i] = n - i;
+	struct bnum_s res;
+	bnum_init(&res, 0);
+	bnum_product(&res, vals, k);
+	fst = bnum_value(&res);
+	
+	free(res.d);
+	free(vals);
+	return memo_put(COMB_PERM, n, k, fst);
+}
+
+
+
+// Constants
 ARITH_FUNC(arith_PI){ return arith_from(3.14159265358979323846); }
 ARITH_FUNC(arith_E){ return arith_from(2.71828182845904523536); }
 
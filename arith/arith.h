@@ -9,17 +9,39 @@
  */
 typedef int arith_err_t;
 #define ARITH_ERR_OK (0)
+#define ARITH_ERR_PLACES (1)
+#define ARITH_ERR_INTEGER (2)
+#define ARITH_ERR_DOMAIN (3)
+#define ARITH_ERR_OVERFLOW (4)
 
 // Resolve arithmetic errors into strings
 const char *arith_strerror(arith_err_t err);
 
 
-// Type for value that can have operations performed on it
+/* Type for value that can have operations performed on it
+ * Decimals combine with other values as follows:
+ *  - Decimal and Real give a Real
+ *  - Decimal and integer Ratio give a Decimal
+ *  - Decimal and non-integer Ratio give a Ratio
+ * Decimal results are exact and only rounded by `round`.
+ * When the exact result doesn't fit a Real is given instead
+ * 
+ * Big integers are produced by combinatorial functions whose results
+ * don't fit in a Ratio. They are kept for the life of the process and
+ * other than `%` by an integer, operations on them give Reals
+ */
 enum arith_type {
 	ARITH_REAL,
-	ARITH_RATIO
+	ARITH_RATIO,
+	ARITH_DEC,
+	ARITH_BIG
 };
 
+struct arith_big_s;
+
+// Largest number of digits after the decimal point
+#define ARITH_DEC_MAXSCALE (9)
+
 typedef struct {
 	enum arith_type type;
 	
@@ -30,6 +52,14 @@ typedef struct {
 			long num;
 			unsigned long den;
 		};
+		
+		struct{  // Decimal number
+			long units;  // Value multiplied by 10 ^ scale
+			int scale;  // Number of digits after the decimal point
+		};
+		
+		// Non-negative integer shared by every copy
+		const struct arith_big_s *big;
 	};
 } arith_t;
 
@@ -49,6 +79,24 @@ int arith_print(FILE *stream, arith_t val);
 
 // Convert arith_t to double
 double arith_todbl(arith_t val);
+// Check if values have the same type and value
+int arith_equal(arith_t x, arith_t y);
+// Hash value such that equal values have equal hashes
+unsigned long arith_hash(arith_t val);
+// Reduce rational value to lowest terms
+void arith_simplify(arith_t *val);
+
+// Ways of rounding decimal values to fewer places
+enum arith_rounding {
+	ARITH_ROUND_HALF_EVEN,  // Nearest with ties to even (Default)
+	ARITH_ROUND_HALF_UP,  // Nearest with ties away from zero
+	ARITH_ROUND_DOWN,  // Toward zero
+	ARITH_ROUND_UP,  // Away from zero
+	ARITH_ROUND_FLOOR,
+	ARITH_ROUND_CEIL
+};
+// Set rounding mode used by `arith_round`
+void arith_set_rounding(enum arith_rounding mode);
 
 
 // Unary Operator
@@ -66,6 +114,7 @@ ARITH_FUNC(arith_pow);
 ARITH_FUNC(arith_abs);
 ARITH_FUNC(arith_floor);
 ARITH_FUNC(arith_ceil);
+ARITH_FUNC(arith_round);
 ARITH_FUNC(arith_sqrt);
 ARITH_FUNC(arith_log);
 ARITH_FUNC(arith_ln);
@@ -73,6 +122,18 @@ ARITH_FUNC(arith_sin);
 ARITH_FUNC(arith_cos);
 ARITH_FUNC(arith_tan);
 
+// Number Theory Functions
+ARITH_FUNC(arith_gcd);
+ARITH_FUNC(arith_lcm);
+ARITH_FUNC(arith_powmod);
+ARITH_FUNC(arith_modinv);
+ARITH_FUNC(arith_isprime);
+
+// Combinatorial Functions
+ARITH_FUNC(arith_factorial);
+ARITH_FUNC(arith_binom);
+ARITH_FUNC(arith_perm);
+
 // Constants
 ARITH_FUNC(arith_PI);
 ARITH_FUNC(arith_E);
@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <getopt.h>
+
+#include "../nmsp.h"
+#include "../docmt.h"
+#include "docgen.h"
+#include "timing.h"
+
+#define PROG_NAME "afed_bench"
+
+const char help_msg[] =
+	"Usage: " PROG_NAME " [OPTION]...\n"
+	"\n"
+	"Time the read, parse, evaluate, and print phases of afed on synthetic documents\n"
+	"\n"
+	"  -r, --repeat N          Number of timed runs per document (default 5)\n"
+	"  -k, --scale N           Multiply the number of lines in each document by N\n"
+	"  -s, --scenario NAME     Only run the named scenario (may be repeated)\n"
+	"  -o, --output FILE       Write results to FILE as tab separated values\n"
+	"  -c, --compare FILE      Compare results against baseline FILE\n"
+	"  -t, --threshold PCT     Percent slowdown flagged as a regression (default 10)\n"
+	"  -h, --help              Print this help message\n"
+;
+
+struct option longopts[] = {
+	{"repeat", required_argument, NULL, 'r'},
+	{"scale", required_argument, NULL, 'k'},
+	{"scenario", required_argument, NULL, 's'},
+	{"output", required_argument, NULL, 'o'},
+	{"compare", required_argument, NULL, 'c'},
+	{"threshold", required_argument, NULL, 't'},
+	{"help", no_argument, NULL, 'h'},
+	{0}
+};
+
+// Document shapes that are benchmarked
+struct scenario_s {
+	const char *name;
+	unsigned int lines, depth, fanin, fanout;
+	double funcs, forward, reals, prose;
+};
+
+const struct scenario_s scenarios[] = {
+	{"base", 4000, 16, 3, 3, 0.02, 0.1, 0.3, 0.1},
+	{"deep", 4000, 500, 2, 2, 0.02, 0.1, 0.3, 0.1},
+	{"wide", 4000, 8, 8, 2, 0.02, 0.1, 0.3, 0.1},
+	{"hot", 4000, 16, 3, 64, 0.02, 0.1, 0.3, 0.1},
+	{"funcs", 4000, 16, 3, 3, 0.2, 0.1, 0.3, 0.1},
+	{"forward", 4000, 16, 3, 3, 0.02, 0.6, 0.3, 0.1},
+	{"reals", 4000, 16, 3, 3, 0.02, 0.1, 1.0, 0.1},
+	{"prose", 4000, 16, 3, 3, 0.02, 0.1, 0.3, 0.5},
+	{0}
+};
+
+// Phases of a single afed run
+enum phase {
+	PHASE_READ,
+	PHASE_PARSE,
+	PHASE_EVAL,
+	PHASE_PRINT,
+	PHASE_TOTAL,
+	PHASE_COUNT
+};
+
+const char *phase_names[PHASE_COUNT] = {"read", "parse", "eval", "print", "total"};
+
+// Result of timing one phase of one scenario
+struct result_s {
+	const char *scenario;
+	enum phase phase;
+	struct bench_stats stats;
+};
+
+
+
+// Time every phase of afed on the document stored at `path`
+static void run_once(const char *path, FILE *devnull, double times[PHASE_COUNT]){
+	uint64_t t0 = bench_now();
+	FILE *fl = fopen(path, "r");
+	char *prog = docmt_read_file(fl);
+	fclose(fl);
+	
+	uint64_t t1 = bench_now();
+	namespace_t nmsp = nmsp_new(true);
+	docmt_t doc = docmt_new(prog, nmsp);
+	docmt_parse(doc, NULL);
+	
+	uint64_t t2 = bench_now();
+	docmt_eval(doc);
+	
+	uint64_t t3 = bench_now();
+	docmt_fprint(doc, devnull, NULL);
+	fflush(devnull);
+	uint64_t t4 = bench_now();
+	
+	times[PHASE_READ] = t1 - t0;
+	times[PHASE_PARSE] = t2 - t1;
+	times[PHASE_EVAL] = t3 - t2;
+	times[PHASE_PRINT] = t4 - t3;
+	times[PHASE_TOTAL] = t4 - t0;
+	
+	docmt_free(doc);
+	nmsp_free(nmsp);
+	free(prog);
+}
+
+// Generate the scenario's document, then time `repeat` runs of it
+static void run_scenario(const struct scenario_s *scn, unsigned int scale, int repeat, struct result_s *res){
+	struct docgen_opts opts;
+	docgen_defaults(&opts);
+	opts.lines = scn->lines * scale;
+	opts.depth = scn->depth;
+	opts.fanin = scn->fanin;
+	opts.fanout = scn->fanout;
+	opts.func_ratio = scn->funcs;
+	opts.fwd_ratio = scn->forward;
+	opts.real_ratio = scn->reals;
+	opts.prose_ratio = scn->prose;
+	
+	// Write document to temporary file so that reading can be timed
+	char path[] = "/tmp/afed_bench_XXXXXX";
+	int fd = mkstemp(path);
+	FILE *fl = fd >= 0 ? fdopen(fd, "w") : NULL;
+	if(!fl){
+		fprintf(stderr, "Unable to create temporary file for \"%s\"\n", scn->name);
+		exit(1);
+	}
+	docgen_fprint(fl, &opts);
+	fclose(fl);
+	
+	FILE *devnull = fopen("/dev/null", "w");
+	double samples[PHASE_COUNT][repeat];
+	for(int r = 0; r < repeat; r++){
+		double times[PHASE_COUNT];
+		run_once(path, devnull, times);
+		for(int p = 0; p < PHASE_COUNT; p++) samples[p][r] = times[p];
+	}
+	fclose(devnull);
+	remove(path);
+	
+	for(int p = 0; p < PHASE_COUNT; p++){
+		res[p].scenario = scn->name;
+		res[p].phase = p;
+		res[p].stats = bench_summary(samples[p], repeat);
+	}
+}
+
+
+
+static void print_results(FILE *stream, const struct result_s *res, size_t len){
+	fprintf(stream, "# scenario\tphase\tmedian_ns\tmean_ns\tstdev_ns\tmin_ns\n");
+	for(size_t i = 0; i < len; i++){
+		struct bench_stats st = res[i].stats;
+		fprintf(stream, "%s\t%s\t%.0f\t%.0f\t%.0f\t%.0f\n",
+			res[i].scenario, phase_names[res[i].phase],
+			st.median, st.mean, st.stdev, st.min
+		);
+	}
+}
+
+/* Compare results to the baseline stored in `path`
+ * Return the number of regressions found
+ */
+static int compare_results(const char *path, const struct result_s *res, size_t len, double thresh){
+	FILE *fl = fopen(path, "r");
+	if(!fl){
+		fprintf(stderr, "Baseline file \"%s\" did not open\n", path);
+		exit(1);
+	}
+	
+	int regs = 0;
+	char line[512];
+	while(fgets(line, sizeof(line), fl)){
+		if(line[0] == '#') continue;
+		
+		char scn[128], phase[32];
+		double median;
+		if(sscanf(line, "%127s %31s %lf", scn, phase, &median) != 3) continue;
+		
+		// Find matching result
+		for(size_t i = 0; i < len; i++){
+			if(strcmp(res[i].scenario, scn) != 0 || strcmp(phase_names[res[i].phase], phase) != 0) continue;
+			
+			double change = median > 0 ? (res[i].stats.median / median - 1) * 100 : 0;
+			bool is_reg = change > thresh;
+			regs += is_reg;
+			printf("%-10s %-6s %14.0f ns -> %14.0f ns  %+7.1f%%%s\n",
+				scn, phase, median, res[i].stats.median, change,
+				is_reg ? "  REGRESSION" : ""
+			);
+		}
+	}
+	
+	fclose(fl);
+	return regs;
+}
+
+
+
+int main(int argc, char *argv[]){
+	int repeat = 5;
+	unsigned int scale = 1;
+	const char *outpath = NULL, *basepath = NULL;
+	double thresh = 10;
+	const char *only[16];
+	size_t onlylen = 0;
+	
+	int c;
+	while((c = getopt_long(argc, argv, "r:k:s:o:c:t:h", longopts, NULL)) != -1) switch(c){
+		case 'r': repeat = atoi(optarg);
+		break;
+		case 'k': scale = strtoul(optarg, NULL, 10);
+		break;
+		case 's':
+			if(onlylen < sizeof(only) / sizeof(*only)) only[onlylen++] = optarg;
+		break;
+		case 'o': outpath = optarg;
+		break;
+		case 'c': basepath = optarg;
+		break;
+		case 't': thresh = strtod(optarg, NULL);
+		break;
+		
+		case 'h':
+			puts(help_msg);
+			return 0;
+		default:
+			fputs("Use --help for more information\n", stderr);
+			return 2;
+	}
+	if(repeat < 1) repeat = 1;
+	if(scale < 1) scale = 1;
+	
+	// Run each selected scenario
+	size_t nscn = sizeof(scenarios) / sizeof(*scenarios) - 1;
+	struct result_s *res = malloc(nscn * PHASE_COUNT * sizeof(struct result_s));
+	size_t len = 0;
+	for(const struct scenario_s *scn = scenarios; scn->name; scn++){
+		bool chosen = onlylen == 0;
+		for(size_t i = 0; i < onlylen && !chosen; i++) chosen = strcmp(only[i], scn->name) == 0;
+		if(!chosen) continue;
+		
+		fprintf(stderr, "Running %s\n", scn->name);
+		run_scenario(scn, scale, repeat, res + len);
+		len += PHASE_COUNT;
+	}
+	
+	print_results(stdout, res, len);
+	if(outpath){
+		FILE *out = fopen(outpath, "w");
+		if(!out){
+			fprintf(stderr, "Output file \"%s\" did not open\n", outpath);
+			return 1;
+		}
+		print_results(out, res, len);
+		fclose(out);
+	}
+	
+	int regs = 0;
+	if(basepath){
+		printf("\n### Comparing against %s\n", basepath);
+		regs = compare_results(basepath, res, len, thresh);
+		printf("Total Regressions: %i\n", regs);
+	}
+	
+	free(res);
+	return regs > 0;
+}
+
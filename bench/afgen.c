@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include "docgen.h"
+
+#define PROG_NAME "afgen"
+
+const char help_msg[] =
+	"Usage: " PROG_NAME " [OPTION]...\n"
+	"\n"
+	"Write a deterministic synthetic afed document to STDOUT\n"
+	"\n"
+	"  -l, --lines N           Number of definitions\n"
+	"  -d, --depth N           Length of the longest dependency chain\n"
+	"  -i, --fan-in N          Variable references per expression\n"
+	"  -f, --fan-out N         Average number of dependents per variable\n"
+	"  -u, --funcs RATIO       Fraction of definitions that are functions\n"
+	"  -w, --forward RATIO     Fraction of definitions placed before their dependencies\n"
+	"  -r, --reals RATIO       Fraction of number literals that are reals\n"
+	"  -p, --prose RATIO       Fraction of lines that are prose\n"
+	"  -P, --print RATIO       Fraction of definitions that are printed\n"
+	"  -s, --seed N            Seed of the generator\n"
+	"  -h, --help              Print this help message\n"
+;
+
+struct option longopts[] = {
+	{"lines", required_argument, NULL, 'l'},
+	{"depth", required_argument, NULL, 'd'},
+	{"fan-in", required_argument, NULL, 'i'},
+	{"fan-out", required_argument, NULL, 'f'},
+	{"funcs", required_argument, NULL, 'u'},
+	{"forward", required_argument, NULL, 'w'},
+	{"reals", required_argument, NULL, 'r'},
+	{"prose", required_argument, NULL, 'p'},
+	{"print", required_argument, NULL, 'P'},
+	{"seed", required_argument, NULL, 's'},
+	{"help", no_argument, NULL, 'h'},
+	{0}
+};
+
+int main(int argc, char *argv[]){
+	struct docgen_opts opts;
+	docgen_defaults(&opts);
+	
+	int c;
+	while((c = getopt_long(argc, argv, "l:d:i:f:u:w:r:p:P:s:h", longopts, NULL)) != -1) switch(c){
+		case 'l': opts.lines = strtoul(optarg, NULL, 10);
+		break;
+		case 'd': opts.depth = strtoul(optarg, NULL, 10);
+		break;
+		case 'i': opts.fanin = strtoul(optarg, NULL, 10);
+		break;
+		case 'f': opts.fanout = strtoul(optarg, NULL, 10);
+		break;
+		case 'u': opts.func_ratio = strtod(optarg, NULL);
+		break;
+		case 'w': opts.fwd_ratio = strtod(optarg, NULL);
+		break;
+		case 'r': opts.real_ratio = strtod(optarg, NULL);
+		break;
+		case 'p': opts.prose_ratio = strtod(optarg, NULL);
+		break;
+		case 'P': opts.print_ratio = strtod(optarg, NULL);
+		break;
+		case 's': opts.seed = strtoull(optarg, NULL, 0);
+		break;
+		
+		case 'h':
+			puts(help_msg);
+			return 0;
+		default:
+			fputs("Use --help for more information\n", stderr);
+			return 2;
+	}
+	
+	if(opts.fanin == 0 || opts.fanout == 0){
+		fputs("Fan-in and fan-out must be positive\n", stderr);
+		return 2;
+	}
+	
+	docgen_fprint(stdout, &opts);
+	return 0;
+}
+
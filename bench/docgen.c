@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "docgen.h"
+
+// Words used to build prose lines
+static const char *words[] = {
+	"the", "total", "for", "this", "quarter", "includes", "freight", "and",
+	"tax", "estimate", "below", "assumes", "rate", "of", "growth", "per",
+	"month", "with", "costs", "split", "between", "teams", "budget", "notes",
+	NULL
+};
+static const size_t word_count = sizeof(words) / sizeof(*words) - 1;
+
+// Deterministic pseudo-random generator (splitmix64)
+static uint64_t next_rand(uint64_t *state){
+	uint64_t z = (*state += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+// Uniform integer in [0, n)
+#define rand_below(st, n) ((unsigned int)(next_rand(st) % (n)))
+// True with probability `p`
+#define rand_chance(st, p) ((next_rand(st) >> 11) * 0x1.0p-53 < (p))
+
+void docgen_defaults(struct docgen_opts *opts){
+	opts->lines = 10000;
+	opts->depth = 16;
+	opts->fanin = 3;
+	opts->fanout = 3;
+	
+	opts->func_ratio = 0.02;
+	opts->fwd_ratio = 0.1;
+	opts->real_ratio = 0.3;
+	opts->prose_ratio = 0.1;
+	opts->print_ratio = 0.5;
+	
+	opts->seed = 0x61666564;
+}
+
+
+
+// Print an integer or real literal
+static void put_literal(FILE *stream, const struct docgen_opts *opts, uint64_t *st){
+	if(rand_chance(st, opts->real_ratio))
+		fprintf(stream, "%u.%02u", rand_below(st, 100), rand_below(st, 100));
+	else fprintf(stream, "%u", 1 + rand_below(st, 99));
+}
+
+// Arity of the `k`th function
+#define func_arity(k) (1 + (k) % 2)
+
+static void put_func(FILE *stream, unsigned int k, const struct docgen_opts *opts, uint64_t *st){
+	if(func_arity(k) == 1){
+		fprintf(stream, "f%u(a) : a * ", k);
+		put_literal(stream, opts, st);
+		fputs(" - ", stream);
+	}else{
+		fprintf(stream, "f%u(a, b) : (a + b) // 2 + ", k);
+	}
+	put_literal(stream, opts, st);
+}
+
+// Layout of variables into levels of the dependency chain
+struct layout_s {
+	unsigned int nfunc, nvar;
+	unsigned int depth;
+	// Index of first variable in each level (`depth + 1` entries)
+	unsigned int *start;
+};
+
+static unsigned int level_of(const struct layout_s *lay, unsigned int i){
+	unsigned int lvl = (unsigned long)i * lay->depth / lay->nvar;
+	while(lvl > 0 && lay->start[lvl] > i) lvl--;
+	while(lay->start[lvl + 1] <= i) lvl++;
+	return lvl;
+}
+
+static void put_var(FILE *stream, unsigned int i, const struct layout_s *lay,
+	const struct docgen_opts *opts, uint64_t *st
+){
+	unsigned int lvl = level_of(lay, i);
+	fprintf(stream, "v%u : ", i);
+	
+	// Inputs only contain literals
+	if(lvl == 0){
+		put_literal(stream, opts, st);
+		fputs(rand_chance(st, 0.5) ? " + " : " * ", stream);
+		put_literal(stream, opts, st);
+		return;
+	}
+	
+	// Select references from a window of the previous level
+	// Narrowing the window raises the fan-out of each referenced variable
+	unsigned int prev = lay->start[lvl - 1];
+	unsigned int size = lay->start[lvl] - prev;
+	unsigned int cur = lay->start[lvl + 1] - lay->start[lvl];
+	unsigned long window = ((unsigned long)size * opts->fanin + opts->fanout - 1) / opts->fanout;
+	if(window < 1) window = 1;
+	if(window > size) window = size;
+	unsigned int base = (unsigned long)(i - lay->start[lvl]) * size / cur;
+	
+	fputc('(', stream);
+	for(unsigned int t = 0; t < opts->fanin; t++){
+		if(t > 0) fputs(rand_chance(st, 0.7) ? " + " : " - ", stream);
+		unsigned int ref = prev + (base + rand_below(st, window)) % size;
+		
+		if(lay->nfunc > 0 && rand_chance(st, opts->func_ratio)){
+			unsigned int k = rand_below(st, lay->nfunc);
+			fprintf(stream, "f%u(v%u", k, ref);
+			if(func_arity(k) == 2){
+				fputs(", ", stream);
+				put_literal(stream, opts, st);
+			}
+			fputc(')', stream);
+		}else fprintf(stream, "v%u", ref);
+	}
+	if(rand_chance(st, 0.5)){
+		fputs(" + ", stream);
+		put_literal(stream, opts, st);
+	}
+	fprintf(stream, ") // %u", opts->fanin);
+}
+
+static void put_prose(FILE *stream, uint64_t *st){
+	unsigned int cnt = 5 + rand_below(st, 6);
+	if(rand_chance(st, 0.25)) fputs("# ", stream);
+	for(unsigned int w = 0; w < cnt; w++){
+		if(w > 0) fputc(' ', stream);
+		fputs(words[rand_below(st, word_count)], stream);
+	}
+}
+
+
+
+unsigned int docgen_fprint(FILE *stream, const struct docgen_opts *opts){
+	uint64_t st = opts->seed;
+	
+	// Split definitions into functions and variables
+	struct layout_s lay;
+	unsigned int ndef = opts->lines > 0 ? opts->lines : 1;
+	lay.nfunc = ndef * opts->func_ratio;
+	lay.nvar = ndef - lay.nfunc;
+	if(lay.nvar == 0){ lay.nvar = 1; lay.nfunc = ndef - 1; }
+	lay.depth = opts->depth < 1 ? 1 : opts->depth > lay.nvar ? lay.nvar : opts->depth;
+	lay.start = malloc((lay.depth + 1) * sizeof(unsigned int));
+	for(unsigned int l = 0; l <= lay.depth; l++)
+		lay.start[l] = (unsigned long)l * lay.nvar / lay.depth;
+	
+	// Order definitions with functions first then by level
+	// Forward references are made by moving marked definitions to the front in reverse
+	unsigned int *order = malloc(ndef * sizeof(unsigned int));
+	bool *forward = malloc(ndef * sizeof(bool));
+	unsigned int front = 0, back = ndef;
+	for(unsigned int d = ndef; d-- > 0;){
+		if((forward[d] = rand_chance(&st, opts->fwd_ratio))) order[front++] = d;
+	}
+	for(unsigned int d = ndef; d-- > 0;){
+		if(!forward[d]) order[--back] = d;
+	}
+	free(forward);
+	
+	// Interleave prose so that it makes up `prose_ratio` of all lines
+	unsigned int nprose = 0;
+	if(opts->prose_ratio > 0 && opts->prose_ratio < 1)
+		nprose = ndef * opts->prose_ratio / (1 - opts->prose_ratio);
+	unsigned int total = ndef + nprose;
+	
+	unsigned int d = 0;
+	for(unsigned int n = 0; n < total; n++){
+		if(nprose > 0 && rand_below(&st, total - n) < nprose){
+			put_prose(stream, &st);
+			nprose--;
+		}else{
+			// Only variables are printed since functions have no value
+			unsigned int id = order[d++];
+			if(id < lay.nfunc) put_func(stream, id, opts, &st);
+			else{
+				put_var(stream, id - lay.nfunc, &lay, opts, &st);
+				if(rand_chance(&st, opts->print_ratio)) fputs(" =", stream);
+			}
+		}
+		fputc('\n', stream);
+	}
+	
+	free(order);
+	free(lay.start);
+	return total;
+}
+
@@ -0,0 +1,33 @@
+#ifndef __DOCGEN_H
+#define __DOCGEN_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Knobs controlling the shape of a synthetic document
+ * The same options and seed always produce the same document
+ */
+struct docgen_opts {
+	unsigned int lines;  // Number of definition lines
+	unsigned int depth;  // Length of the longest dependency chain
+	unsigned int fanin;  // Variable references per expression
+	unsigned int fanout;  // Average number of dependents of a variable
+	
+	double func_ratio;  // Fraction of definitions that are user-defined functions
+	double fwd_ratio;  // Fraction of definitions placed before their dependencies
+	double real_ratio;  // Fraction of number literals that are reals instead of integers
+	double prose_ratio;  // Fraction of lines that are prose sentences
+	double print_ratio;  // Fraction of definitions whose value is printed
+	
+	uint64_t seed;
+};
+
+// Fill `opts` with the defaults used by the benchmarks
+void docgen_defaults(struct docgen_opts *opts);
+
+// Write document described by `opts` to `stream`
+// Returns number of lines written
+unsigned int docgen_fprint(FILE *stream, const struct docgen_opts *opts);
+
+#endif
+
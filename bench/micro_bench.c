@@ -0,0 +1,471 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <getopt.h>
+
+#include "../nmsp.h"
+#include "../bltn.h"
+#include "../arith/arith.h"
+#include "../util/mcode.h"
+#include "../util/ptree.h"
+#include "../util/queue.h"
+#include "timing.h"
+
+#define PROG_NAME "micro_bench"
+
+const char help_msg[] =
+	"Usage: " PROG_NAME " [OPTION]...\n"
+	"\n"
+	"Time core data structures and arithmetic kernels in nanoseconds per operation\n"
+	"\n"
+	"  -f, --filter TEXT       Only run benchmarks whose name contains TEXT\n"
+	"  -n, --samples N         Number of timed samples per benchmark (default 10)\n"
+	"  -m, --sample-time MS    Minimum length of each sample in milliseconds (default 2)\n"
+	"  -o, --output FILE       Write results to FILE as tab separated values\n"
+	"  -h, --help              Print this help message\n"
+;
+
+struct option longopts[] = {
+	{"filter", required_argument, NULL, 'f'},
+	{"samples", required_argument, NULL, 'n'},
+	{"sample-time", required_argument, NULL, 'm'},
+	{"output", required_argument, NULL, 'o'},
+	{"help", no_argument, NULL, 'h'},
+	{0}
+};
+
+// Tables of builtins defined in bltn.c
+extern struct bltn_oper_s builtin_opers[];
+extern struct bltn_s builtins[];
+
+// Prevent the compiler from removing benchmarked work
+volatile long sink;
+
+// Run an operation `iters` times using `ctx`
+typedef void (*bench_func_t)(void *ctx, size_t iters);
+
+// Options shared by every benchmark
+int nsamples = 10;
+double sample_ns = 2e6;
+const char *filter = NULL;
+FILE *outfile = NULL;
+
+/* Time `fn` and print its nanoseconds per operation
+ * The number of iterations is doubled until one sample takes `sample_ns`
+ */
+static void run_bench(const char *name, bench_func_t fn, void *ctx){
+	if(filter && !strstr(name, filter)) return;
+	
+	size_t iters = 1;
+	for(;;){
+		uint64_t start = bench_now();
+		fn(ctx, iters);
+		if(bench_now() - start >= sample_ns || iters >= ((size_t)1 << 40)) break;
+		iters <<= 1;
+	}
+	
+	double samples[nsamples];
+	for(int s = 0; s < nsamples; s++){
+		uint64_t start = bench_now();
+		fn(ctx, iters);
+		samples[s] = (double)(bench_now() - start) / iters;
+	}
+	
+	struct bench_stats st = bench_summary(samples, nsamples);
+	printf("%-32s %12.2f ns/op  +- %8.2f  (min %10.2f, %zu iters)\n",
+		name, st.mean, st.stdev, st.min, iters
+	);
+	if(outfile) fprintf(outfile, "%s\t%.3f\t%.3f\t%.3f\t%.3f\n",
+		name, st.mean, st.stdev, st.median, st.min
+	);
+}
+
+
+
+/*  Parse Tree
+ * ============
+ */
+struct ptree_ctx {
+	ptree_t tree;
+	const char **words;
+};
+
+static void bench_ptree(void *ctx, size_t iters){
+	struct ptree_ctx *pc = ctx;
+	const char *end;
+	for(size_t i = 0; i < iters; i++){
+		const char *w = pc->words[i & 7];
+		sink += (long)ptree_getn(pc->tree, w, -1, &end);
+	}
+}
+
+static void bench_oper_parse(void *ctx, size_t iters){
+	const char **words = ctx;
+	const char *end;
+	for(size_t i = 0; i < iters; i++){
+		sink += (long)bltn_oper_parse(words[i & 7], &end, false);
+	}
+}
+
+static void run_ptree(){
+	// Operator strings followed by content to stop matching
+	static const char *words[8] = {"+ x", "- y", "* 2", "/ z", "// 3", "% w", "^ 4", "$$"};
+	
+	struct ptree_ctx pc = {ptree_new(), words};
+	for(struct bltn_oper_s *op = builtin_opers; op->name; op++)
+		if(!op->is_unary) ptree_put(&pc.tree, op->name, op);
+	
+	run_bench("ptree_getn/operators", bench_ptree, &pc);
+	run_bench("bltn_oper_parse/binary", bench_oper_parse, words);
+	ptree_free(pc.tree);
+}
+
+
+
+/*  Queue
+ * =======
+ */
+static void bench_queue_single(void *ctx, size_t iters){
+	queue_t q = ctx;
+	void *p = q;
+	for(size_t i = 0; i < iters; i++){
+		queue_push(q, &p, 1);
+		sink += (long)queue_pop(q);
+	}
+}
+
+static void bench_queue_batch(void *ctx, size_t iters){
+	queue_t q = ctx;
+	void *ptrs[16] = {q};
+	for(size_t i = 0; i < iters; i++){
+		queue_push(q, ptrs, 16);
+		for(int j = 0; j < 16; j++) sink += (long)queue_pop(q);
+	}
+}
+
+static void run_queue(){
+	struct queue_s q = queue_new(8);
+	// Keep some elements in the queue so that the buffer wraps around
+	void *fill[5] = {0};
+	queue_push(&q, fill, 5);
+	
+	run_bench("queue_push_pop/single", bench_queue_single, &q);
+	run_bench("queue_push_pop/batch16", bench_queue_batch, &q);
+	queue_free(q);
+}
+
+
+
+/*  Namespace Lookup
+ * ==================
+ */
+struct nmsp_ctx {
+	namespace_t nmsp;
+	size_t size;
+	char *names;  // Fixed width names of variables
+	bool miss;  // Whether to lookup names that aren't present
+};
+
+#define NAME_WIDTH 8
+
+static void bench_nmsp_get(void *ctx, size_t iters){
+	struct nmsp_ctx *nc = ctx;
+	for(size_t i = 0; i < iters; i++){
+		const char *name = nc->names + (i % nc->size) * NAME_WIDTH;
+		sink += (long)nmsp_get(nc->nmsp, name + nc->miss, strlen(name + nc->miss));
+	}
+}
+
+static void run_nmsp(){
+	static const size_t sizes[] = {16, 256, 4096, 0};
+	for(const size_t *sz = sizes; *sz; sz++){
+		struct nmsp_ctx nc;
+		nc.nmsp = nmsp_new(true);
+		nc.size = *sz;
+		nc.names = malloc(*sz * NAME_WIDTH);
+		
+		// Names are prefixed with 'x' so that skipping it produces a miss
+		for(size_t i = 0; i < *sz; i++){
+			char *name = nc.names + i * NAME_WIDTH;
+			snprintf(name, NAME_WIDTH, "xv%zu", i);
+			nmsp_put(nc.nmsp, name, strlen(name));
+		}
+		
+		char bname[64];
+		nc.miss = false;
+		snprintf(bname, sizeof(bname), "nmsp_get/hit/%zu", *sz);
+		run_bench(bname, bench_nmsp_get, &nc);
+		nc.miss = true;
+		snprintf(bname, sizeof(bname), "nmsp_get/miss/%zu", *sz);
+		run_bench(bname, bench_nmsp_get, &nc);
+		
+		nmsp_free(nc.nmsp);
+		free(nc.names);
+	}
+}
+
+
+
+/*  Code Evaluation
+ * =================
+ */
+struct mcode_ctx {
+	mcode_t code;
+	arith_t args[2];
+};
+
+static void bench_mcode_eval(void *ctx, size_t iters){
+	struct mcode_ctx *mc = ctx;
+	arith_err_t err;
+	for(size_t i = 0; i < iters; i++){
+		arith_t val = mcode_eval(mc->code, mc->args, &err);
+		sink += val.type + err;
+	}
+}
+
+static arith_t make_real(double r){
+	arith_t val;
+	val.type = ARITH_REAL;
+	val.real = r;
+	return val;
+}
+
+static arith_t make_ratio(long num, unsigned long den){
+	arith_t val;
+	val.type = ARITH_RATIO;
+	val.num = num;
+	val.den = den;
+	return val;
+}
+
+static arith_t make_dec(long units, int scale){
+	arith_t val;
+	val.type = ARITH_DEC;
+	val.units = units;
+	val.scale = scale;
+	return val;
+}
+
+// Build `3 * x * x + 2 * x - 7` with argument `x`
+static mcode_t build_poly(){
+	mcode_t code = mcode_new(1, 16);
+	mcode_load_const(code, make_ratio(3, 1));
+	mcode_load_arg(code, 0);
+	mcode_call_func(code, 2, arith_mul, false);
+	mcode_load_arg(code, 0);
+	mcode_call_func(code, 2, arith_mul, false);
+	mcode_load_const(code, make_ratio(2, 1));
+	mcode_load_arg(code, 0);
+	mcode_call_func(code, 2, arith_mul, false);
+	mcode_call_func(code, 2, arith_add, false);
+	mcode_load_const(code, make_ratio(7, 1));
+	mcode_call_func(code, 2, arith_sub, false);
+	return code;
+}
+
+static void run_mcode(){
+	struct mcode_ctx mc;
+	
+	// Variable whose value is cached after the first evaluation
+	mc.code = mcode_new(0, 4);
+	mcode_load_const(mc.code, make_ratio(3, 4));
+	mcode_load_const(mc.code, make_real(1.5));
+	mcode_call_func(mc.code, 2, arith_add, false);
+	run_bench("mcode_eval/cached_var", bench_mcode_eval, &mc);
+	mcode_t cached = mc.code;
+	
+	// Polynomial function over both value types
+	mcode_t poly = build_poly();
+	mc.code = poly;
+	mc.args[0] = make_ratio(5, 3);
+	run_bench("mcode_eval/poly(Q)", bench_mcode_eval, &mc);
+	mc.args[0] = make_real(1.6);
+	run_bench("mcode_eval/poly(R)", bench_mcode_eval, &mc);
+	
+	// Function calling another function and a cached variable
+	// f(x, y) = poly(x) * y + c
+	mc.code = mcode_new(2, 8);
+	mcode_load_arg(mc.code, 0);
+	mcode_call_code(mc.code, poly);
+	mcode_load_arg(mc.code, 1);
+	mcode_call_func(mc.code, 2, arith_mul, false);
+	mcode_call_code(mc.code, cached);
+	mcode_call_func(mc.code, 2, arith_add, false);
+	mc.args[0] = make_ratio(5, 3);
+	mc.args[1] = make_real(0.25);
+	run_bench("mcode_eval/nested_call", bench_mcode_eval, &mc);
+	
+	mcode_free(mc.code);
+	mcode_free(poly);
+	mcode_free(cached);
+}
+
+
+
+/*  Arithmetic Kernels
+ * ====================
+ */
+struct arith_ctx {
+	arith_func_t func;
+	int arity;
+	arith_t args[4];
+};
+
+static void bench_arith(void *ctx, size_t iters){
+	struct arith_ctx *ac = ctx;
+	arith_t args[4];
+	arith_err_t err = ARITH_ERR_OK;
+	for(size_t i = 0; i < iters; i++){
+		// Functions may modify their arguments in place
+		memcpy(args, ac->args, sizeof(args));
+		arith_t val = ac->func(args, &err);
+		sink += val.type;
+	}
+	sink += err;
+}
+
+static void bench_simplify(void *ctx, size_t iters){
+	arith_t *val = ctx;
+	for(size_t i = 0; i < iters; i++){
+		arith_t tmp = *val;
+		arith_simplify(&tmp);
+		sink += tmp.num;
+	}
+}
+
+/* Benchmark `func` for every combination of value types
+ * Each argument is either a real (R), a ratio (Q), or a decimal (D)
+ */
+static void run_arith_func(const char *name, arith_func_t func, int arity){
+	static const double reals[4] = {2.75, 1.25, 3.5, 0.75};
+	static const long nums[4] = {7, 5, 9, 11};
+	static const unsigned long dens[4] = {3, 2, 4, 1};
+	static const long units[4] = {1234, 250, 35, 2};
+	static const int scales[4] = {2, 2, 1, 0};
+	
+	struct arith_ctx ac;
+	ac.func = func;
+	ac.arity = arity;
+	int combos = 1;
+	for(int i = 0; i < arity; i++) combos *= 3;
+	for(int mask = 0; mask < combos; mask++){
+		char bname[64];
+		int len = snprintf(bname, sizeof(bname), "arith/%s(", name);
+		for(int i = 0, m = mask; i < arity; i++, m /= 3){
+			char kind = "QRD"[m % 3];
+			switch(kind){
+				case 'Q': ac.args[i] = make_ratio(nums[i], dens[i]);
+				break;
+				case 'R': ac.args[i] = make_real(reals[i]);
+				break;
+				case 'D': ac.args[i] = make_dec(units[i], scales[i]);
+				break;
+			}
+			len += snprintf(bname + len, sizeof(bname) - len, i ? ",%c" : "%c", kind);
+		}
+		snprintf(bname + len, sizeof(bname) - len, ")");
+		run_bench(bname, bench_arith, &ac);
+	}
+}
+
+static void run_arith(){
+	arith_t val = make_ratio(2 * 3 * 5 * 7 * 11 * 13, 3 * 7 * 13 * 17);
+	run_bench("arith_simplify/small", bench_simplify, &val);
+	val = make_ratio(1134903170L * 433494437L, 701408733L * 433494437L);
+	run_bench("arith_simplify/fibonacci", bench_simplify, &val);
+	
+	for(struct bltn_oper_s *op = builtin_opers; op->name; op++){
+		char name[16];
+		snprintf(name, sizeof(name), "%s%s", op->is_unary ? "u" : "", op->name);
+		run_arith_func(name, op->func, op->is_unary ? 1 : 2);
+	}
+	for(struct bltn_s *bl = builtins; bl->name; bl++) run_arith_func(bl->name, bl->func, bl->arity);
+}
+
+
+
+/*  Number Theory
+ * ===============
+ */
+static void run_int_func(const char *name, arith_func_t func, int arity, const long *ints){
+	struct arith_ctx ac;
+	ac.func = func;
+	ac.arity = arity;
+	for(int i = 0; i < arity; i++) ac.args[i] = make_ratio(ints[i], 1);
+	run_bench(name, bench_arith, &ac);
+}
+
+static void run_numth(){
+	// Odd moduli use Montgomery multiplication and even ones 128-bit remainders
+	run_int_func("numth/powmod/odd32", arith_powmod, 3, (long[]){123456789, 987654321, 1000000007});
+	run_int_func("numth/powmod/odd63", arith_powmod, 3, (long[]){123456789, 987654321, 9223372036854775783L});
+	run_int_func("numth/powmod/even63", arith_powmod, 3, (long[]){123456789, 987654321, 9223372036854775782L});
+	run_int_func("numth/powmod/inverse", arith_powmod, 3, (long[]){123456789, -987654321, 1000000007});
+	
+	// Primes take every round of Miller-Rabin and composites usually one
+	run_int_func("numth/isprime/small", arith_isprime, 1, (long[]){997});
+	run_int_func("numth/isprime/prime61", arith_isprime, 1, (long[]){2305843009213693951L});
+	run_int_func("numth/isprime/strong_pseudoprime", arith_isprime, 1, (long[]){3825123056546413051L});
+	
+	run_int_func("numth/gcd/fibonacci", arith_gcd, 2, (long[]){1134903170L * 433494437L, 701408733L * 433494437L});
+	run_int_func("numth/lcm/small", arith_lcm, 2, (long[]){2 * 3 * 5 * 7 * 11 * 13, 3 * 7 * 13 * 17});
+	run_int_func("numth/modinv/fibonacci", arith_modinv, 2, (long[]){1134903170, 1836311903});
+}
+
+static void run_comb(){
+	// Small results come from tables and others from the cache after the first call
+	run_int_func("comb/factorial/table", arith_factorial, 1, (long[]){20});
+	run_int_func("comb/factorial/cached", arith_factorial, 1, (long[]){1000});
+	run_int_func("comb/binom/table", arith_binom, 2, (long[]){60, 30});
+	run_int_func("comb/binom/cached", arith_binom, 2, (long[]){1000, 500});
+	run_int_func("comb/perm/table", arith_perm, 2, (long[]){20, 10});
+	run_int_func("comb/perm/cached", arith_perm, 2, (long[]){1000, 100});
+}
+
+
+
+int main(int argc, char *argv[]){
+	const char *outpath = NULL;
+	
+	int c;
+	while((c = getopt_long(argc, argv, "f:n:m:o:h", longopts, NULL)) != -1) switch(c){
+		case 'f': filter = optarg;
+		break;
+		case 'n': nsamples = atoi(optarg);
+		break;
+		case 'm': sample_ns = strtod(optarg, NULL) * 1e6;
+		break;
+		case 'o': outpath = optarg;
+		break;
+		
+		case 'h':
+			puts(help_msg);
+			return 0;
+		default:
+			fputs("Use --help for more information\n", stderr);
+			return 2;
+	}
+	if(nsamples < 2) nsamples = 2;
+	
+	if(outpath){
+		outfile = fopen(outpath, "w");
+		if(!outfile){
+			fprintf(stderr, "Output file \"%s\" did not open\n", outpath);
+			return 1;
+		}
+		fprintf(outfile, "# benchmark\tmean_ns\tstdev_ns\tmedian_ns\tmin_ns\n");
+	}
+	
+	run_ptree();
+	run_queue();
+	run_nmsp();
+	run_mcode();
+	run_arith();
+	run_numth();
+	run_comb();
+	
+	if(outfile) fclose(outfile);
+	return 0;
+}
+
@@ -0,0 +1,53 @@
+#ifndef __TIMING_H
+#define __TIMING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+// Current time of monotonic clock in nanoseconds
+static inline uint64_t bench_now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Summary of a set of timing samples
+struct bench_stats {
+	double mean, stdev;
+	double median, min, max;
+};
+
+static int bench_cmp_dbl(const void *a, const void *b){
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+// Compute statistics of `n` samples
+// WARNING: Sorts `samples` in place
+static inline struct bench_stats bench_summary(double *samples, size_t n){
+	struct bench_stats st = {0};
+	if(n == 0) return st;
+	
+	qsort(samples, n, sizeof(double), bench_cmp_dbl);
+	st.min = samples[0];
+	st.max = samples[n - 1];
+	st.median = n & 1 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+	
+	for(size_t i = 0; i < n; i++) st.mean += samples[i];
+	st.mean /= n;
+	for(size_t i = 0; i < n; i++) st.stdev += (samples[i] - st.mean) * (samples[i] - st.mean);
+	st.stdev = n > 1 ? sqrt(st.stdev / (n - 1)) : 0;
+	return st;
+}
+
+// Value at percentile `pct` of sorted `samples`
+static inline double bench_percentile(const double *samples, size_t n, double pct){
+	if(n == 0) return 0;
+	size_t i = (size_t)(pct / 100 * (n - 1) + 0.5);
+	return samples[i < n ? i : n - 1];
+}
+
+#endif
+
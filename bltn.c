@@ -19,12 +19,21 @@ struct bltn_s builtins[] = {
 	{"abs", 1, arith_abs},
 	{"floor", 1, arith_floor},
 	{"ceil", 1, arith_ceil},
+	{"round", 2, arith_round},
 	{"sqrt", 1, arith_sqrt},
 	{"log", 2, arith_log},
 	{"ln", 1, arith_ln},
 	{"sin", 1, arith_sin},
 	{"cos", 1, arith_cos},
 	{"tan", 1, arith_tan},
+	{"gcd", 2, arith_gcd},
+	{"lcm", 2, arith_lcm},
+	{"powmod", 3, arith_powmod},
+	{"modinv", 2, arith_modinv},
+	{"isprime", 1, arith_isprime},
+	{"factorial", 1, arith_factorial},
+	{"binom", 2, arith_binom},
+	{"perm", 2, arith_perm},
 	{"pi", 0, arith_PI},
 	{"e", 0, arith_E},
 	{0}
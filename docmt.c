@@ -2,6 +2,7 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <ctype.h>
 #include <stdio.h>
 
@@ -104,6 +105,23 @@ docmt_t docmt_new(const char *str, namespace_t nmsp){
 // Get associate namespace
 namespace_t docmt_get_nmsp(docmt_t doc){ return doc->nmsp; }
 
+// Copy document mapping printed variables into `nmsp`
+docmt_t docmt_fork(docmt_t doc, namespace_t nmsp){
+	docmt_t fork = malloc(sizeof(struct docmt_s));
+	*fork = *doc;
+	fork->nmsp = nmsp;
+	
+	// Copy pieces replacing variables
+	fork->pccap = doc->pclen > 0 ? doc->pclen : 1;
+	fork->pieces = malloc(sizeof(struct piece_s) * fork->pccap);
+	for(size_t i = 0; i < doc->pclen; i++){
+		struct piece_s pc = doc->pieces[i];
+		if(!pc.is_slice) pc.source.var = nmsp_view(nmsp, pc.source.var);
+		fork->pieces[i] = pc;
+	}
+	return fork;
+}
+
 // Deallocate document
 void docmt_free(docmt_t doc){
 	free(doc->pieces);
@@ -202,6 +220,20 @@ int docmt_parse(docmt_t doc, FILE *errout){
 }
 
 
+int docmt_eval(docmt_t doc){
+	int errcnt = 0;
+	for(size_t i = 0; i < doc->pclen; i++){
+		struct piece_s pc = doc->pieces[i];
+		if(pc.is_slice) continue;
+		
+		// Value is cached by the variable's code block
+		parse_err_t err;
+		nmsp_var_value(pc.source.var, &err);
+		errcnt += !!err;
+	}
+	return errcnt;
+}
+
 int docmt_fprint(docmt_t doc, FILE *stream, FILE *errout){
 	int errcnt = 0;  // Keep track of how many errors occur
 	for(size_t i = 0; i < doc->pclen; i++){
@@ -238,3 +270,129 @@ int docmt_fprint(docmt_t doc, FILE *stream, FILE *errout){
 }
 
 
+
+
+// Identifies a printed result when comparing documents
+struct result_s {
+	const char *key;  // Name of variable or text of statement
+	size_t keylen;
+	unsigned long hash;
+	
+	var_t var;
+	int line_no;
+	bool matched;
+};
+
+// Collect results of document
+static struct result_s *collect_results(docmt_t doc, size_t *lenp){
+	struct result_s *res = malloc(sizeof(struct result_s) * (doc->pclen + 1));
+	size_t len = 0;
+	for(size_t i = 0; i < doc->pclen; i++){
+		struct piece_s pc = doc->pieces[i];
+		if(pc.is_slice) continue;
+		
+		struct result_s *r = res + len++;
+		r->var = pc.source.var;
+		r->line_no = pc.line_no;
+		r->matched = false;
+		
+		r->key = nmsp_var_name(r->var, &r->keylen);
+		if(!r->key && i > 0 && doc->pieces[i - 1].is_slice){
+			// Use text of statement, from the slice before '=', for unnamed results
+			const char *start = doc->pieces[i - 1].source.slice.start;
+			const char *end = start + doc->pieces[i - 1].source.slice.length - 1;
+			const char *nl = end;
+			while(nl > start && nl[-1] != '\n') nl--;
+			while(nl < end && isspace(*nl)) nl++;
+			while(end > nl && isspace(end[-1])) end--;
+			r->key = nl;
+			r->keylen = end - nl;
+		}
+		
+		r->hash = 0;
+		for(size_t j = 0; j < r->keylen; j++) r->hash = r->hash * 31 + r->key[j];
+	}
+	
+	*lenp = len;
+	return res;
+}
+
+// Order pointers to results by key
+static int cmp_results(const void *a, const void *b){
+	const struct result_s *x = *(struct result_s**)a, *y = *(struct result_s**)b;
+	if(x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+	if(x->keylen != y->keylen) return x->keylen < y->keylen ? -1 : 1;
+	return strncmp(x->key, y->key, x->keylen);
+}
+
+// Print result as diff line
+static void print_result(FILE *stream, char sign, struct result_s *r){
+	fprintf(stream, "%c %.*s = ", sign, (int)r->keylen, r->key);
+	nmsp_var_fprint(stream, r->var);
+	fputc('\n', stream);
+}
+
+int docmt_fprint_diff(docmt_t doc, docmt_t old, FILE *stream){
+	// Evaluate unchanged definitions only once
+	nmsp_share(doc->nmsp, old->nmsp);
+	
+	size_t newlen, oldlen;
+	struct result_s *news = collect_results(doc, &newlen);
+	struct result_s *olds = collect_results(old, &oldlen);
+	
+	// Sort old results to find matches
+	struct result_s **sorted = malloc(sizeof(struct result_s*) * (oldlen + 1));
+	for(size_t i = 0; i < oldlen; i++) sorted[i] = olds + i;
+	qsort(sorted, oldlen, sizeof(struct result_s*), cmp_results);
+	
+	int diffcnt = 0;
+	for(size_t i = 0; i < newlen; i++){
+		struct result_s *r = news + i, *o = NULL, **match = NULL;
+		if(r->key) match = bsearch(&r, sorted, oldlen, sizeof(struct result_s*), cmp_results);
+		if(match) o = *match;
+		
+		// Compare values and errors
+		arith_err_t err, olderr;
+		arith_t val = nmsp_var_value(r->var, &err);
+		if(o){
+			o->matched = true;
+			arith_t oldval = nmsp_var_value(o->var, &olderr);
+			if(err == olderr && (err || arith_equal(val, oldval))) continue;
+		}
+		diffcnt++;
+		
+		if(!stream) continue;
+		if(o) fprintf(stream, "@@ Line %i -> %i @@\n", o->line_no, r->line_no);
+		else fprintf(stream, "@@ Line %i @@\n", r->line_no);
+		if(o) print_result(stream, '-', o);
+		print_result(stream, '+', r);
+	}
+	
+	// Report results that were removed
+	for(size_t i = 0; i < oldlen; i++){
+		if(olds[i].matched) continue;
+		diffcnt++;
+		if(stream){
+			fprintf(stream, "@@ Line %i removed @@\n", olds[i].line_no);
+			print_result(stream, '-', olds + i);
+		}
+	}
+	
+	free(sorted);
+	free(news);
+	free(olds);
+	return diffcnt;
+}
+
+
+
+char *docmt_read_file(FILE *fl){
+	size_t len = 0, cap = 1024;  // Begin with 1024 bytes of capacity
+	char *cont = malloc(sizeof(char) * cap);
+	while((len += fread(cont + len, 1, cap - len - 1, fl)) >= cap - 1){  // Consume input until EOF
+		cap <<= 1;
+		cont = realloc(cont, sizeof(char) * cap);
+	}
+	cont[len] = '\0';
+	return cont;
+}
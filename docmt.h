@@ -14,6 +14,10 @@ typedef struct docmt_s *docmt_t;
 docmt_t docmt_new(const char *str, namespace_t nmsp);
 // Return the namespace associated to the document
 namespace_t docmt_get_nmsp(docmt_t doc);
+/* Create copy of document whose printed variables
+ * are those seen from `nmsp`, usually a fork of its namespace
+ */
+docmt_t docmt_fork(docmt_t doc, namespace_t nmsp);
 /* Deallocate memory for document
  * NOT including the associated namespace
  */
@@ -22,9 +26,22 @@ void docmt_free(docmt_t doc);
 // Parse statements in string producing pieces
 // Return number of parse errors that occur
 int docmt_parse(docmt_t doc, FILE *errout);
+// Evaluate the variable of every printed piece caching its value
+// Return number of evaluation errors
+int docmt_eval(docmt_t doc);
 // Print pieces to `stream`
 // Return number of evaluation errors
 int docmt_fprint(docmt_t doc, FILE *stream, FILE *errout);
+/* Print the results of `doc` whose values differ from those of `old`
+ * Named results are matched by name and others by their statement
+ * Variables defined the same in both documents are evaluated once
+ * Return number of differing results
+ */
+int docmt_fprint_diff(docmt_t doc, docmt_t old, FILE *stream);
+
+
+// Read contents of file into heap allocated, null-terminated string
+char *docmt_read_file(FILE *fl);
 
 #endif
 
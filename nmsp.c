@@ -4,6 +4,7 @@
 #include <ctype.h>
 
 // Utilities
+#include "util/vec.h"  // Vectors of tokens
 #include "util/queue.h"  // Queue of variables
 #include "util/mcode.h"  // Executable code blocks
 
@@ -17,6 +18,14 @@ typedef uint32_t hash_t;
 struct var_s {
 	mcode_t code;  // Code Block defining this variable
 	bool has_impl : 1;  // Whether code block has been filled
+	// Whether variable is a copy, made by a fork, of a parent's variable
+	bool is_clone : 1;
+	// Used while searching for the dependents of an overridden variable
+	unsigned int mark : 2;
+	
+	struct namespace_s *owner;  // Namespace containing this variable
+	// Variable of a parent namespace which this one replaces
+	struct var_s *orig;
 	
 	// Array of dependencies of `code`
 	size_t deplen;
@@ -36,6 +45,58 @@ struct var_s {
 	struct var_s *used_by;
 };
 
+/* Kinds of token produced by the expression scanner
+ * Each kind maps onto a single shunting yard call
+ */
+enum token_type {
+	TOKEN_OPEN, TOKEN_COMMA, TOKEN_CLOSE,
+	TOKEN_OPER,  // Unary or Binary operator
+	TOKEN_CONST,  // Literal or builtin constant
+	TOKEN_ARG,  // Argument of the function being defined
+	TOKEN_BLTN,  // Builtin function call
+	TOKEN_VAR, TOKEN_CALL  // Variable load or user-defined function call
+};
+
+struct token_s {
+	enum token_type type;
+	const char *start;  // Location of token in the parsed string
+	
+	union {
+		bltn_oper_t oper;
+		arith_t value;
+		int arg;
+		bltn_t bltn;
+		var_t var;
+	};
+};
+
+/* Compiled form of an expression shape
+ * Expressions with the same sequence of tokens, up to which
+ * variables and literals they reference, compile to the same code
+ */
+struct shape_s {
+	hash_t hash;  // Hash of `key`
+	size_t keylen;
+	char *key;
+	
+	/* Code compiled from the first expression with this shape
+	 * Calls to `slots[i]` must be rebound for each new expression
+	 */
+	mcode_t tmpl;
+	size_t nslots;
+	mcode_t *slots;
+	int *arities;  // Arity required of each slot
+	
+	/* When constants were folded into the template
+	 * only expressions with the same literal text match
+	 * Otherwise `lits` is NULL and literals are rebound too
+	 */
+	size_t litlen;
+	char *lits;
+	
+	struct shape_s *next;  // Next shape in the same bucket
+};
+
 struct namespace_s {
 	// Head of Linked List of variables
 	struct var_s *head;
@@ -55,8 +116,31 @@ struct namespace_s {
 	 * to simplify literals while parsing
 	 */
 	bool try_eval;
+	
+	// Hash table of previously compiled expression shapes
+	size_t shape_count, shape_cap;
+	struct shape_s **shapes;
+	
+	// Scratch space reused by each call to mcode_parse
+	vec_t(struct token_s) tokens;
+	vec_t(char) key;
+	vec_t(char) lits;
+	vec_t(var_t) slots;
+	
+	// Namespace whose variables are shared by this fork or NULL
+	struct namespace_s *parent;
+	/* Hash table of variables in this namespace
+	 * which replace a variable of a parent, keyed by `orig`
+	 */
+	size_t shadow_count, shadow_cap;
+	var_t *shadows;
 };
 
+// Values of `mark` when searching for dependents
+#define MARK_UNSEEN 0
+#define MARK_SAME 1
+#define MARK_CHANGED 2
+
 
 
 static hash_t hash(const char *str, size_t len);
@@ -76,6 +160,30 @@ static bool var_calc_deps(namespace_t nmsp, var_t vr);
  */
 static bool find_circ(namespace_t nmsp, var_t start);
 
+/* Check whether `vr` is defined the same as the variable of the same name in `src`
+ * The result is stored in the `mark` of `vr`
+ */
+static bool same_def(namespace_t src, var_t vr);
+
+/* Find the variable of `nmsp` which replaces `vr` of a parent
+ * Return `vr` if it isn't replaced
+ */
+static var_t var_view(namespace_t nmsp, var_t vr);
+// Find or insert variable in the shadow table of `nmsp`
+static var_t shadow_get(namespace_t nmsp, var_t vr);
+static void shadow_put(namespace_t nmsp, var_t vr);
+
+/* Replace `oldvar`, a parent's variable or clone, by the expression in `str`
+ * Every variable depending on `oldvar` is cloned into `nmsp`
+ * with its calls rebound to the replacements
+ */
+static var_t override_var(namespace_t nmsp, var_t oldvar, size_t arity, const char *str, const char **endptr, const char *args, parse_err_t *errp);
+
+/* Remove and deallocate every variable placed after `mark`
+ * Used to undo the placeholders created by a failed definition
+ */
+static void rollback_vars(namespace_t nmsp, var_t mark);
+
 
 /* Read sequence of alphanumerics and '_' as a name
  * Return index of matching argument from `args` or -1 if none found
@@ -87,6 +195,29 @@ static int parse_arg(const char *name, size_t namelen, const char *args);
  */
 static var_t parse_var(const char *name, size_t namelen, namespace_t nmsp);
 
+/* Split as much as possible of `str` into `nmsp->tokens`
+ * While doing so build the shape key in `nmsp->key`
+ * and collect referenced variables into `nmsp->slots`
+ */
+static parse_err_t scan_tokens(const char *str, const char **endptr, const char *args, namespace_t nmsp);
+
+/* Find shape matching `nmsp->key` and `nmsp->lits`
+ * Return NULL if no such shape has been compiled
+ */
+static struct shape_s *shape_find(namespace_t nmsp, hash_t keyhash);
+
+/* Store copy of successfully compiled `code` as template
+ * for the shape currently described by `nmsp->key`
+ * If `folded` then the template is specific to `nmsp->lits`
+ */
+static void shape_store(namespace_t nmsp, hash_t keyhash, mcode_t code, bool folded);
+
+/* Append the template of `shp` to `code` rebinding slots to `nmsp->slots`
+ * and constants to those of `nmsp->tokens` which are consumed on success
+ * Return true if the slots can't be bound and the expression must be shunted
+ */
+static bool shape_instance(namespace_t nmsp, struct shape_s *shp, mcode_t code);
+
 /* Primary method for parsing expression
  * Parses as much as possuble of the string
  * If `err` is not NULL then any errors are stored in it
@@ -155,6 +286,14 @@ int nmsp_var_fprint(FILE *stream, var_t vr){
 }
 
 
+// Mix hashes of dependency names into code hash
+unsigned long nmsp_var_hash(var_t vr){
+	unsigned long h = mcode_hash(vr->code);
+	for(size_t i = 0; i < vr->deplen; i++) h = (h ^ vr->deps[i]->hash) * 0x100000001b3;
+	return h;
+}
+
+
 
 /* Allocate namespace
  *  If eval_on_parse then the namespace will
@@ -166,6 +305,39 @@ namespace_t nmsp_new(bool eval_on_parse){
 	nmsp->redef = NULL;
 	nmsp->circ_root = NULL;
 	nmsp->try_eval = eval_on_parse;
+	
+	// Start with an empty shape cache
+	nmsp->shape_count = 0;
+	nmsp->shape_cap = 64;
+	nmsp->shapes = calloc(nmsp->shape_cap, sizeof(struct shape_s*));
+	
+	vecinit(nmsp->tokens, 16);
+	vecinit(nmsp->key, 64);
+	vecinit(nmsp->lits, 32);
+	vecinit(nmsp->slots, 8);
+	
+	// Namespace doesn't share any variables
+	nmsp->parent = NULL;
+	nmsp->shadow_count = 0;
+	nmsp->shadow_cap = 0;
+	nmsp->shadows = NULL;
+	return nmsp;
+}
+
+// Create namespace which shares variables with `parent`
+namespace_t nmsp_fork(namespace_t parent){
+	// Fill caches so forks only ever read shared code blocks
+	for(namespace_t ns = parent; ns; ns = ns->parent){
+		for(var_t vr = ns->head; vr; vr = vr->next){
+			if(!vr->has_impl || mcode_get_arity(vr->code) != 0) continue;
+			
+			arith_err_t err;
+			arith_free(mcode_eval(vr->code, NULL, &err));
+		}
+	}
+	
+	namespace_t nmsp = nmsp_new(parent->try_eval);
+	nmsp->parent = parent;
 	return nmsp;
 }
 
@@ -178,12 +350,36 @@ void nmsp_free(namespace_t nmsp){
 		
 		// Free any code block the variable might have
 		if(vr->code) mcode_free(vr->code);
+		if(vr->deps) free(vr->deps);
 		
 		// Get pointer to next variable
 		next = vr->next;
 		free(vr);
 	}
 	
+	// Free compiled expression shapes
+	for(size_t i = 0; i < nmsp->shape_cap; i++){
+		struct shape_s *shp, *nxt = nmsp->shapes[i];
+		while(nxt){
+			shp = nxt;
+			nxt = shp->next;
+			
+			mcode_free(shp->tmpl);
+			free(shp->key);
+			free(shp->slots);
+			free(shp->arities);
+			free(shp->lits);
+			free(shp);
+		}
+	}
+	free(nmsp->shapes);
+	
+	vecfree(nmsp->tokens);
+	vecfree(nmsp->key);
+	vecfree(nmsp->lits);
+	vecfree(nmsp->slots);
+	if(nmsp->shadows) free(nmsp->shadows);
+	
 	// Deallocate namespace itself
 	free(nmsp);
 }
@@ -196,15 +392,109 @@ var_t nmsp_get(namespace_t nmsp, const char *key, size_t keylen){
 	if(!key || keylen == 0) return NULL;
 	
 	hash_t keyhash = hash(key, keylen);
+	// Variables of a fork hide those of its parents
+	for(; nmsp; nmsp = nmsp->parent){
+		for(var_t vr = nmsp->head; vr; vr = vr->next){
+			if(vr->hash == keyhash  // Check for matching hash (should filter out most time)
+			&& vr->namelen == keylen  // Check for same length
+			&& strncmp(vr->name, key, keylen) == 0)  // Finally perform string comparison
+				return vr;
+		}
+	}
+	return NULL;
+}
+
+// Seed caches of variables defined the same as in `src`
+size_t nmsp_share(namespace_t nmsp, namespace_t src){
+	for(namespace_t ns = nmsp; ns; ns = ns->parent)
+		for(var_t v = ns->head; v; v = v->next) v->mark = MARK_UNSEEN;
+	
+	size_t count = 0;
 	for(var_t vr = nmsp->head; vr; vr = vr->next){
-		if(vr->hash == keyhash  // Check for matching hash (should filter out most time)
-		&& vr->namelen == keylen  // Check for same length
-		&& strncmp(vr->name, key, keylen) == 0)  // Finally perform string comparison
-			return vr;
+		if(!same_def(src, vr) || mcode_get_arity(vr->code) != 0) continue;
+		
+		// Evaluate in `src` and use the value in `nmsp`
+		var_t other = nmsp_get(src, vr->name, vr->namelen);
+		arith_err_t err = EVAL_ERR_OK;
+		arith_t val = mcode_eval(other->code, NULL, &err);
+		mcode_seed(vr->code, val, err);
+		count++;
+	}
+	return count;
+}
+
+static bool same_def(namespace_t src, var_t vr){
+	if(vr->mark != MARK_UNSEEN) return vr->mark == MARK_SAME;
+	vr->mark = MARK_CHANGED;
+	
+	var_t other = nmsp_get(src, vr->name, vr->namelen);
+	if(!other || !vr->has_impl || !other->has_impl
+	|| vr->deplen != other->deplen
+	|| mcode_get_arity(vr->code) != mcode_get_arity(other->code)
+	|| nmsp_var_hash(vr) != nmsp_var_hash(other)
+	) return false;
+	
+	// Dependencies must have the same names and definitions
+	for(size_t i = 0; i < vr->deplen; i++){
+		var_t dep = vr->deps[i];
+		if(dep->namelen != other->deps[i]->namelen
+		|| strncmp(dep->name, other->deps[i]->name, dep->namelen) != 0
+		|| !same_def(src, dep)
+		) return false;
+	}
+	
+	vr->mark = MARK_SAME;
+	return true;
+}
+
+// Get variable seen from `nmsp` in place of `vr`
+var_t nmsp_view(namespace_t nmsp, var_t vr){
+	return vr ? var_view(nmsp, vr) : NULL;
+}
+
+static var_t var_view(namespace_t nmsp, var_t vr){
+	// Search the forks between `nmsp` and the owner of `vr`
+	for(; nmsp && nmsp != vr->owner; nmsp = nmsp->parent){
+		var_t shd = shadow_get(nmsp, vr);
+		if(shd) return shd;
 	}
+	return vr;
+}
+
+// Hash of variable's address used by the shadow table
+#define shadow_hash(vr) ((size_t)(vr) >> 4)
+
+// Use linear probing over the hashes of the replaced variables
+static var_t shadow_get(namespace_t nmsp, var_t vr){
+	if(nmsp->shadow_count == 0) return NULL;
+	if(vr->orig) vr = vr->orig;  // Shadows are keyed by the first variable replaced
+	
+	size_t mask = nmsp->shadow_cap - 1;
+	for(size_t i = shadow_hash(vr) & mask; nmsp->shadows[i]; i = (i + 1) & mask)
+		if(nmsp->shadows[i]->orig == vr) return nmsp->shadows[i];
 	return NULL;
 }
 
+static void shadow_put(namespace_t nmsp, var_t vr){
+	// Keep table at most half full
+	if(2 * (nmsp->shadow_count + 1) > nmsp->shadow_cap){
+		var_t *old = nmsp->shadows;
+		size_t oldcap = nmsp->shadow_cap;
+		
+		nmsp->shadow_cap = oldcap ? oldcap << 1 : 16;
+		nmsp->shadows = calloc(nmsp->shadow_cap, sizeof(var_t));
+		nmsp->shadow_count = 0;
+		for(size_t i = 0; i < oldcap; i++) if(old[i]) shadow_put(nmsp, old[i]);
+		if(old) free(old);
+	}
+	
+	size_t mask = nmsp->shadow_cap - 1;
+	size_t i = shadow_hash(vr->orig) & mask;
+	while(nmsp->shadows[i]) i = (i + 1) & mask;
+	nmsp->shadows[i] = vr;
+	nmsp->shadow_count++;
+}
+
 
 
 // Place new variable in namespace
@@ -214,6 +504,10 @@ static var_t place_var_unsafe(namespace_t nmsp, const char *key, size_t keylen,
 	// Set Expression with no cached value yet
 	vr->code = code;
 	vr->has_impl = isimpl;
+	vr->is_clone = false;
+	vr->mark = MARK_UNSEEN;
+	vr->owner = nmsp;
+	vr->orig = NULL;
 	
 	// Calculate dependencies of code block
 	vr->deplen = 0;  vr->deps = NULL;  // Initialize empty dependency list
@@ -249,9 +543,11 @@ static bool var_calc_deps(namespace_t nmsp, var_t vr){
 	for(size_t i = 0; i < deplen; i++){
 		mcode_t cd_dep = code_deps[i];
 		var_t vr_dep = NULL;
-		for(var_t v = nmsp->head; v; v = v->next) if(v->code == cd_dep){
-			vr_dep = v;
-			break;
+		for(namespace_t ns = nmsp; ns && !vr_dep; ns = ns->parent){
+			for(var_t v = ns->head; v; v = v->next) if(v->code == cd_dep){
+				vr_dep = v;
+				break;
+			}
 		}
 		
 		// Throw error if no variable is found
@@ -269,6 +565,18 @@ static bool var_calc_deps(namespace_t nmsp, var_t vr){
 	return false;
 }
 
+// Variables are placed at the head so those after `mark` are the newest
+static void rollback_vars(namespace_t nmsp, var_t mark){
+	while(nmsp->head && nmsp->head != mark){
+		var_t vr = nmsp->head;
+		nmsp->head = vr->next;
+		
+		if(vr->code) mcode_free(vr->code);
+		if(vr->deps) free(vr->deps);
+		free(vr);
+	}
+}
+
 // Create variable with given name but with no expression
 var_t nmsp_put(namespace_t nmsp, const char *key, size_t keylen){
 	// Return if there already is a variable with that name
@@ -292,11 +600,14 @@ static bool find_circ(namespace_t nmsp, var_t start){
 	nmsp->circ_root = NULL;
 	for(var_t v = nmsp->head; v; v = v->next) v->used_by = NULL;
 	
-	// Initialize with start's immediate dependencies
+	/* Initialize with start's immediate dependencies
+	 * Variables of a parent never depend on those of a fork
+	 */
 	struct queue_s q = queue_new(8);
-	queue_push(&q, (void**)start->deps, start->deplen);
-	// Set their reference to `start`
-	for(size_t i = 0; i < start->deplen; i++) start->deps[i]->used_by = start;
+	for(size_t i = 0; i < start->deplen; i++) if(start->deps[i]->owner == nmsp){
+		start->deps[i]->used_by = start;  // Set their reference to `start`
+		queue_push(&q, (void**)(start->deps + i), 1);
+	}
 	
 	// Iterate over variables checking their dependencies
 	while(q.len > 0){  // While there are remaining variables to check
@@ -315,11 +626,12 @@ static bool find_circ(namespace_t nmsp, var_t start){
 		
 		var_t *deps = vr->deps;
 		size_t deplen = vr->deplen;
-		// Add all variables used by `vr` to the queue
-		queue_push(&q, (void**)deps, deplen);
-		// If `used_by` is not already set
+		// Add variables used by `vr` that haven't been reached yet to the queue
 		// Set the `used_by` pointer to point to the parent node in the dependency tree
-		for(int i = 0; i < deplen; i++) if(!deps[i]->used_by) deps[i]->used_by = vr;
+		for(int i = 0; i < deplen; i++) if(deps[i]->owner == nmsp && !deps[i]->used_by){
+			deps[i]->used_by = vr;
+			queue_push(&q, (void**)(deps + i), 1);
+		}
 	}
 	
 	queue_free(q);  // Free queue
@@ -396,6 +708,10 @@ var_t nmsp_define(namespace_t nmsp, const char *str, const char **endptr, parse_
 	// Check for Existing Variable
 	// ----------------------------
 	var_t oldvar = nmsp_get(nmsp, lbl, lbl_len);
+	// Variables shared with a parent are replaced instead of redefined
+	if(oldvar && (oldvar->owner != nmsp || oldvar->is_clone))
+		return override_var(nmsp, oldvar, arity, str, endptr, args, errp);
+	
 	mcode_t code = NULL;
 	if(oldvar){
 		if(oldvar->has_impl){  // Check for redefinition
@@ -415,10 +731,18 @@ var_t nmsp_define(namespace_t nmsp, const char *str, const char **endptr, parse_
 	// Create new code block if none present
 	if(!code) code = mcode_new(arity, 8);
 	
+	// Variables placed after `mark` are placeholders made while parsing
+	var_t mark = nmsp->head;
+	
 	// Parse Expression
 	// -----------------
 	*errp = mcode_parse(code, str, endptr, args, nmsp);
-	if(*errp) return NULL;  // On Parse Error
+	if(*errp){  // On Parse Error undo any changes to namespace
+		if(oldvar) mcode_reset(code);
+		else mcode_free(code);
+		rollback_vars(nmsp, mark);
+		return NULL;
+	}
 	
 	
 	// Insert Expression
@@ -430,6 +754,13 @@ var_t nmsp_define(namespace_t nmsp, const char *str, const char **endptr, parse_
 		if(find_circ(nmsp, oldvar)){  // Check for circular dependency
 			mcode_reset(oldvar->code);  // Reset code block
 			oldvar->has_impl = false;
+			
+			// Remove dependencies which may refer to removed placeholders
+			free(oldvar->deps);
+			oldvar->deps = NULL;
+			oldvar->deplen = 0;
+			rollback_vars(nmsp, mark);
+			
 			*errp = INSERT_ERR_CIRC;
 			return NULL;
 		}
@@ -439,6 +770,132 @@ var_t nmsp_define(namespace_t nmsp, const char *str, const char **endptr, parse_
 	}else return place_var_unsafe(nmsp, lbl, lbl_len, code, true);
 }
 
+// Check whether `vr`, seen from `nmsp`, depends on a changed variable
+static bool mark_dependents(namespace_t nmsp, var_t vr){
+	if(vr->mark != MARK_UNSEEN) return vr->mark == MARK_CHANGED;
+	
+	vr->mark = MARK_SAME;
+	for(size_t i = 0; i < vr->deplen; i++){
+		if(mark_dependents(nmsp, var_view(nmsp, vr->deps[i]))){
+			vr->mark = MARK_CHANGED;
+			break;
+		}
+	}
+	return vr->mark == MARK_CHANGED;
+}
+
+static var_t override_var(namespace_t nmsp, var_t oldvar, size_t arity, const char *str, const char **endptr, const char *args, parse_err_t *errp){
+	int old_arity = mcode_get_arity(oldvar->code);
+	if(old_arity >= 0 && old_arity != arity){  // Check for matching arity
+		*errp = PARSE_ERR_ARITY_MISMATCH;
+		return NULL;
+	}
+	
+	// Parse replacement expression
+	// -----------------------------
+	var_t mark = nmsp->head;
+	mcode_t code = mcode_new(arity, 8);
+	*errp = mcode_parse(code, str, endptr, args, nmsp);
+	if(*errp){
+		mcode_free(code);
+		rollback_vars(nmsp, mark);
+		return NULL;
+	}
+	
+	// Find dependents of `oldvar`
+	// ----------------------------
+	for(namespace_t ns = nmsp; ns; ns = ns->parent)
+		for(var_t v = ns->head; v; v = v->next) v->mark = MARK_UNSEEN;
+	oldvar->mark = MARK_CHANGED;
+	
+	vec_t(var_t) deps;
+	vecinit(deps, 8);
+	for(namespace_t ns = nmsp; ns; ns = ns->parent){
+		for(var_t v = ns->head; v; v = v->next){
+			// Skip variables hidden by a fork
+			if(v == oldvar || var_view(nmsp, v) != v) continue;
+			if(mark_dependents(nmsp, v)) vecpush(deps, v);
+		}
+	}
+	
+	// Map the code of `oldvar` and of its dependents to their replacements
+	size_t n = deps.len + 1;
+	mcode_t *olds = malloc(2 * n * sizeof(mcode_t)), *news = olds + n;
+	olds[0] = oldvar->code;
+	news[0] = code;
+	for(size_t i = 1; i < n; i++){
+		olds[i] = deps.ptr[i - 1]->code;
+		news[i] = mcode_new(mcode_get_arity(olds[i]), 8);
+	}
+	
+	// Replacement can't use the variables it changes
+	size_t calllen;
+	mcode_t *calls = mcode_deplist(code, &calllen);
+	bool is_circ = false;
+	for(size_t i = 0; i < calllen && !is_circ; i++)
+		for(size_t j = 0; j < n && !is_circ; j++) is_circ = calls[i] == olds[j];
+	if(calls) free(calls);
+	
+	if(is_circ){
+		for(size_t i = 0; i < n; i++) mcode_free(news[i]);
+		free(olds);
+		vecfree(deps);
+		rollback_vars(nmsp, mark);
+		
+		nmsp->circ_root = oldvar;
+		oldvar->used_by = oldvar;
+		*errp = INSERT_ERR_CIRC;
+		return NULL;
+	}
+	
+	// Copy dependents rebinding their calls
+	for(size_t i = 1; i < n; i++) mcode_append(news[i], olds[i], olds, news, n, NULL);
+	
+	// Install replacements
+	// ---------------------
+	var_t vr = oldvar;
+	if(oldvar->owner == nmsp){  // Replace code of clone
+		mcode_free(oldvar->code);
+		oldvar->code = code;
+		oldvar->is_clone = false;
+	}else{
+		vr = place_var_unsafe(nmsp, oldvar->name, oldvar->namelen, code, true);
+		vr->orig = oldvar->orig ? oldvar->orig : oldvar;
+		shadow_put(nmsp, vr);
+	}
+	var_calc_deps(nmsp, vr);
+	
+	for(size_t i = 1; i < n; i++){
+		var_t dep = deps.ptr[i - 1];
+		if(dep->owner == nmsp){  // Update variable already owned by the fork
+			mcode_free(dep->code);
+			dep->code = news[i];
+		}else{
+			var_t cln = place_var_unsafe(nmsp, dep->name, dep->namelen, news[i], false);
+			cln->has_impl = true;
+			cln->is_clone = true;
+			
+			// Calls are the same as those of the original
+			cln->deplen = dep->deplen;
+			cln->deps = malloc(dep->deplen * sizeof(var_t));
+			memcpy(cln->deps, dep->deps, dep->deplen * sizeof(var_t));
+			cln->orig = dep->orig ? dep->orig : dep;
+			shadow_put(nmsp, cln);
+			deps.ptr[i - 1] = cln;
+		}
+	}
+	
+	// Dependencies now refer to the replacements
+	for(size_t i = 0; i < deps.len; i++){
+		var_t dep = deps.ptr[i];
+		for(size_t j = 0; j < dep->deplen; j++) dep->deps[j] = var_view(nmsp, dep->deps[j]);
+	}
+	
+	free(olds);
+	vecfree(deps);
+	return vr;
+}
+
 
 
 // Returns the number of characters placed into buf not including the null-byte
@@ -524,11 +981,36 @@ static var_t parse_var(const char *name, size_t namelen, namespace_t nmsp){
 	}else return NULL;
 }
 
-// Parses String as Expression
-static parse_err_t mcode_parse(mcode_t code, const char *str, const char **endptr, const char *args, namespace_t nmsp){
-	shunt_t shn = shunt_new(code, nmsp->try_eval, 4);  // Initialize shunting yard
-	parse_err_t err = PARSE_ERR_OK;  // Store any parse errors
+// Append `tag` followed by `len` bytes of `data` to the shape key
+static void key_put(namespace_t nmsp, char tag, const void *data, size_t len){
+	vecpush(nmsp->key, tag);
+	while(nmsp->key.len + len > nmsp->key.cap){
+		nmsp->key.cap <<= 1;
+		nmsp->key.ptr = realloc(nmsp->key.ptr, nmsp->key.cap);
+	}
+	if(len > 0) memcpy(nmsp->key.ptr + nmsp->key.len, data, len);
+	nmsp->key.len += len;
+}
+
+// Get index of `vr` among the referenced variables, adding it if missing
+static int slot_of(namespace_t nmsp, var_t vr){
+	for(size_t i = 0; i < nmsp->slots.len; i++)
+		if(nmsp->slots.ptr[i] == vr) return i;
 	
+	vecpush(nmsp->slots, vr);
+	return nmsp->slots.len - 1;
+}
+
+// Tokenize String while building its shape key
+static parse_err_t scan_tokens(const char *str, const char **endptr, const char *args, namespace_t nmsp){
+	nmsp->tokens.len = 0;
+	nmsp->key.len = 0;
+	nmsp->lits.len = 0;
+	nmsp->slots.len = 0;
+	parse_err_t err = PARSE_ERR_OK;
+	
+	// Whether an operator would follow a value
+	bool last_val = false;
 	// Track parenthesis depth to see if newlines should be consumed
 	int parenth_depth = 0;
 	const char *after_tok = str;  // Pointer to after parse token
@@ -538,101 +1020,280 @@ static parse_err_t mcode_parse(mcode_t code, const char *str, const char **endpt
 		if(parenth_depth == 0 && *str == '\n') break;  // Leave at newline outside parenthesis
 		after_tok = str;
 		
+		struct token_s tok;
+		tok.start = str;
+		
 		int c = *str;
 		if(c == '('){
 			after_tok++;  // Consume '('
 			parenth_depth++;
-			if(err = shunt_open_parenth(shn)) break;
-			continue;
+			tok.type = TOKEN_OPEN;
+			key_put(nmsp, '(', NULL, 0);
 		}else if(c == ','){
 			if(parenth_depth == 0){  // Comma must be inside parentheses
 				err = PARSE_ERR_BAD_COMMA;
 				break;
 			}
 			after_tok++;  // Consume ','
-			if(err = shunt_put_comma(shn)) break;
-			continue;
+			tok.type = TOKEN_COMMA;
+			key_put(nmsp, ',', NULL, 0);
 		}else if(c == ')'){
 			after_tok++;  // Consume ')'
 			parenth_depth--;
-			if(err = shunt_close_parenth(shn)) break;
-			continue;
-		}
+			tok.type = TOKEN_CLOSE;
+			key_put(nmsp, ')', NULL, 0);
 		
 		// Try to parse operator
-		bltn_oper_t oper = bltn_oper_parse(str, &after_tok, !shunt_was_last_val(shn));
-		if(oper && after_tok > str){
-			if(oper->is_unary){
-				if(err = shunt_put_unary(shn, oper->func, oper->prec)) break;
-			}else{
-				if(err = shunt_put_binary(shn, oper->func, oper->prec, oper->assoc)) break;
-			}
-			continue;
-		}
-		
+		}else if((tok.oper = bltn_oper_parse(str, &after_tok, !last_val)) && after_tok > str){
+			tok.type = TOKEN_OPER;
+			key_put(nmsp, 'o', &tok.oper, sizeof(bltn_oper_t));
 		
 		// Try to parse constant
-		arith_t val = arith_parse(str, &after_tok);
-		if(after_tok > str){
-			if(err = shunt_load_const(shn, val)) break;
-			continue;
-		}
-		
-		
-		// Collect word characters
-		after_tok = str;
-		while(isalnum(*after_tok) || *after_tok == '_') after_tok++;
-		size_t namelen = after_tok - str;
-		if(namelen == 0) break;  // Unknown token
-		
-		// Try to parse argument name
-		int argind = parse_arg(str, namelen, args);
-		if(argind >= 0){
-			if(err = shunt_load_arg(shn, argind)) break;
-			continue;
-		}
+		}else if(tok.value = arith_parse(str, &after_tok), after_tok > str){
+			if(last_val){  // Shunting would fail on value after value
+				err = PARSE_ERR_MISSING_OPERS;
+				break;
+			}
+			tok.type = TOKEN_CONST;
+			key_put(nmsp, 'c', NULL, 0);
+			
+			// Keep null-terminated literal text in case constants get folded
+			for(const char *l = str; l < after_tok; l++) vecpush(nmsp->lits, *l);
+			vecpush(nmsp->lits, '\0');
 		
-		// Try to parse builtin function or constant name
-		bltn_t bltn = bltn_parse(str, namelen);
-		if(bltn){
-			if(bltn->arity == 0){  // When `bltn` is a constant
-				if(err = shunt_load_const(shn, bltn->func(NULL, NULL))) break;
-			}else{  // When `bltn` is a function
-				if(err = shunt_func_call(shn, bltn->arity, bltn->func)) break;
+		}else{
+			// Collect word characters
+			after_tok = str;
+			while(isalnum(*after_tok) || *after_tok == '_') after_tok++;
+			size_t namelen = after_tok - str;
+			if(namelen == 0) break;  // Unknown token
+			if(last_val){  // Avoid resolving words that can't be shunted
+				err = PARSE_ERR_MISSING_OPERS;
+				break;
 			}
-			continue;
+			
+			// Try to parse argument name
+			if((tok.arg = parse_arg(str, namelen, args)) >= 0){
+				tok.type = TOKEN_ARG;
+				key_put(nmsp, 'a', &tok.arg, sizeof(int));
+			
+			// Try to parse builtin function or constant name
+			}else if(tok.bltn = bltn_parse(str, namelen)){
+				key_put(nmsp, 'b', &tok.bltn, sizeof(bltn_t));
+				if(tok.bltn->arity == 0){  // When `bltn` is a constant
+					tok.type = TOKEN_CONST;
+					tok.value = tok.bltn->func(NULL, NULL);
+				}else tok.type = TOKEN_BLTN;
+			
+			// Try to parse variable name
+			}else if(tok.var = parse_var(str, namelen, nmsp)){
+				// Check if next character is '('
+				const char *tmp = after_tok;
+				while(parenth_depth > 0 ? isspace(*tmp) : isblank(*tmp)) tmp++;
+				
+				// Variables are only distinguished by order of first appearance
+				int slot = slot_of(nmsp, tok.var);
+				tok.type = *tmp == '(' ? TOKEN_CALL : TOKEN_VAR;
+				key_put(nmsp, tok.type == TOKEN_CALL ? 'f' : 'v', &slot, sizeof(int));
+			
+			}else break;  // Failed to parse token
 		}
 		
-		// Try to parse variable name
-		// Collect alphanumerics and _
-		var_t vr = parse_var(str, namelen, nmsp);
-		if(vr){
-			// Check if next character is '('
-			const char *tmp = after_tok;
-			while(parenth_depth > 0 ? isspace(*tmp) : isblank(*tmp)) tmp++;
-			
-			if(*tmp == '('){  // Treat `vr` as a user-defined function
-				if(err = shunt_code_call(shn, vr->code)) break;
-			}else{  // Treat `vr` as a variable
-				if(err = shunt_load_var(shn, vr->code)) break;
+		last_val = tok.type == TOKEN_CLOSE || tok.type == TOKEN_CONST
+			|| tok.type == TOKEN_ARG || tok.type == TOKEN_VAR;
+		vecpush(nmsp->tokens, tok);
+	}
+	
+	// Move endpointer to after scanned section
+	if(endptr) *endptr = str;
+	return err;
+}
+
+
+
+// Find compiled shape with the current key
+static struct shape_s *shape_find(namespace_t nmsp, hash_t keyhash){
+	struct shape_s *shp = nmsp->shapes[keyhash % nmsp->shape_cap];
+	for(; shp; shp = shp->next){
+		if(shp->hash == keyhash && shp->keylen == nmsp->key.len
+		&& memcmp(shp->key, nmsp->key.ptr, shp->keylen) == 0
+		&& (!shp->lits || (shp->litlen == nmsp->lits.len
+			&& memcmp(shp->lits, nmsp->lits.ptr, shp->litlen) == 0)))
+			return shp;
+	}
+	return NULL;
+}
+
+// Store template for the current key
+static void shape_store(namespace_t nmsp, hash_t keyhash, mcode_t code, bool folded){
+	// Double number of buckets when table becomes full
+	if(nmsp->shape_count >= nmsp->shape_cap){
+		size_t cap = nmsp->shape_cap << 1;
+		struct shape_s **shapes = calloc(cap, sizeof(struct shape_s*));
+		for(size_t i = 0; i < nmsp->shape_cap; i++){
+			struct shape_s *shp, *nxt = nmsp->shapes[i];
+			while(nxt){
+				shp = nxt;
+				nxt = shp->next;
+				shp->next = shapes[shp->hash % cap];
+				shapes[shp->hash % cap] = shp;
 			}
-			continue;
 		}
 		
-		break;  // Failed to parse token
+		free(nmsp->shapes);
+		nmsp->shapes = shapes;
+		nmsp->shape_cap = cap;
 	}
 	
-	// Move endpointer to after parsed section
-	if(endptr) *endptr = str;
+	struct shape_s *shp = malloc(sizeof(struct shape_s));
+	shp->hash = keyhash;
+	shp->keylen = nmsp->key.len;
+	shp->key = malloc(shp->keylen);
+	memcpy(shp->key, nmsp->key.ptr, shp->keylen);
+	
+	// Copy code without rebinding any calls
+	shp->tmpl = mcode_new(mcode_get_arity(code), 8);
+	mcode_append(shp->tmpl, code, NULL, NULL, 0, NULL);
+	
+	shp->litlen = 0;
+	shp->lits = NULL;
+	if(folded){
+		shp->litlen = nmsp->lits.len;
+		shp->lits = malloc(shp->litlen + 1);
+		memcpy(shp->lits, nmsp->lits.ptr, shp->litlen);
+	}
+	
+	// Remember variables the template calls and their arities
+	shp->nslots = nmsp->slots.len;
+	shp->slots = malloc(shp->nslots * sizeof(mcode_t));
+	shp->arities = malloc(shp->nslots * sizeof(int));
+	for(size_t i = 0; i < shp->nslots; i++){
+		shp->slots[i] = nmsp->slots.ptr[i]->code;
+		shp->arities[i] = mcode_get_arity(shp->slots[i]);
+	}
+	
+	// Place shape in bucket
+	shp->next = nmsp->shapes[keyhash % nmsp->shape_cap];
+	nmsp->shapes[keyhash % nmsp->shape_cap] = shp;
+	nmsp->shape_count++;
+}
+
+// Instantiate template by rebinding its slots
+static bool shape_instance(namespace_t nmsp, struct shape_s *shp, mcode_t code){
+	var_t *slots = nmsp->slots.ptr;
+	if(nmsp->slots.len != shp->nslots) return true;
+	
+	// Each variable must be able to take on the arity of its slot
+	for(size_t i = 0; i < shp->nslots; i++){
+		int arity = mcode_get_arity(slots[i]->code);
+		if(arity >= 0 && arity != shp->arities[i]) return true;
+	}
+	
+	mcode_t news[shp->nslots + 1];
+	for(size_t i = 0; i < shp->nslots; i++){
+		news[i] = slots[i]->code;
+		mcode_set_arity(news[i], shp->arities[i]);
+	}
+	
+	// Unless they were folded, constants are loaded in the order they appear
+	struct token_s *toks = nmsp->tokens.ptr;
+	arith_t consts[nmsp->tokens.len + 1];
+	size_t nconst = 0;
+	for(size_t i = 0; i < nmsp->tokens.len; i++)
+		if(toks[i].type == TOKEN_CONST) consts[nconst++] = toks[i].value;
+	
+	return mcode_append(code, shp->tmpl, shp->slots, news, shp->nslots, shp->lits ? NULL : consts);
+}
+
+// Free constants of tokens which were never shunted
+static void free_tokens(struct token_s *toks, size_t len){
+	for(size_t i = 0; i < len; i++)
+		if(toks[i].type == TOKEN_CONST) arith_free(toks[i].value);
+}
+
+// Parses String as Expression
+static parse_err_t mcode_parse(mcode_t code, const char *str, const char **endptr, const char *args, namespace_t nmsp){
+	const char *scan_end;
+	parse_err_t scan_err = scan_tokens(str, &scan_end, args, nmsp);
+	struct token_s *toks = nmsp->tokens.ptr;
+	size_t ntoks = nmsp->tokens.len;
+	
+	// Reuse code compiled for an earlier expression of the same shape
+	hash_t keyhash = hash(nmsp->key.ptr, nmsp->key.len);
+	struct shape_s *shp = NULL;
+	if(!scan_err && ntoks > 0){
+		shp = shape_find(nmsp, keyhash);
+		if(shp && !shape_instance(nmsp, shp, code)){
+			if(shp->lits) free_tokens(toks, ntoks);
+			if(endptr) *endptr = scan_end;
+			return PARSE_ERR_OK;
+		}
+	}
+	
+	shunt_t shn = shunt_new(code, nmsp->try_eval, 4);  // Initialize shunting yard
+	parse_err_t err = PARSE_ERR_OK;  // Store any parse errors
+	
+	size_t i;
+	for(i = 0; i < ntoks; i++){
+		struct token_s *tok = toks + i;
+		switch(tok->type){
+			case TOKEN_OPEN: err = shunt_open_parenth(shn);
+			break;
+			case TOKEN_COMMA: err = shunt_put_comma(shn);
+			break;
+			case TOKEN_CLOSE: err = shunt_close_parenth(shn);
+			break;
+			case TOKEN_OPER:
+				if(tok->oper->is_unary) err = shunt_put_unary(shn, tok->oper->func, tok->oper->prec);
+				else err = shunt_put_binary(shn, tok->oper->func, tok->oper->prec, tok->oper->assoc);
+			break;
+			case TOKEN_CONST: err = shunt_load_const(shn, tok->value);
+			break;
+			case TOKEN_ARG: err = shunt_load_arg(shn, tok->arg);
+			break;
+			case TOKEN_BLTN: err = shunt_func_call(shn, tok->bltn->arity, tok->bltn->func);
+			break;
+			case TOKEN_VAR: err = shunt_load_var(shn, tok->var->code);
+			break;
+			case TOKEN_CALL: err = shunt_code_call(shn, tok->var->code);
+			break;
+		}
+		if(err) break;
+	}
 	
 	if(err){  // On error cleanup and leave
+		if(endptr) *endptr = toks[i].start;  // Point to token which failed
+		free_tokens(toks + i, ntoks - i);
 		shunt_free(shn);
 		return err;
 	}
 	
+	// Move endpointer to after parsed section
+	if(endptr) *endptr = scan_end;
+	if(scan_err){
+		shunt_free(shn);
+		return scan_err;
+	}
+	
 	// Clear out remaining operators on the operator stack
-	if(err = shunt_clear(shn)) return err;
+	err = shunt_clear(shn);
 	shunt_free(shn);
+	if(err) return err;
+	
+	// Fusing long chains changes the length so check for folding first
+	size_t len = mcode_length(code);
+	mcode_fuse(code);
+	
+	// Remember compiled code for later expressions of the same shape
+	if(!shp && ntoks > 0 && !mcode_error(code)){
+		// Without folding every token other than punctuation emits one instruction
+		size_t ninstr = 0;
+		for(size_t i = 0; i < ntoks; i++) switch(toks[i].type){
+			case TOKEN_OPEN: case TOKEN_COMMA: case TOKEN_CLOSE: break;
+			default: ninstr++;
+		}
+		shape_store(nmsp, keyhash, code, len != ninstr);
+	}
 	return PARSE_ERR_OK;
 }
 
@@ -50,14 +50,34 @@ const char *nmsp_var_name(var_t vr, size_t *len);
 arith_t nmsp_var_value(var_t vr, arith_err_t *errp);
 // Print the value in var to the given stream
 int nmsp_var_fprint(FILE *stream, var_t vr);
+// Hash of the variable's code and the names of the variables it uses
+unsigned long nmsp_var_hash(var_t vr);
 
 // Constructor and Destructor for Namespace
 namespace_t nmsp_new(bool eval_on_parse);
 void nmsp_free(namespace_t nmsp);
 
+/* Create namespace sharing the variables of `parent`
+ * Defining a variable of `parent` in the fork overrides it,
+ * copying only the variables which depend on it.
+ * Every constant of `parent` is evaluated first so that
+ * forks may be evaluated in separate threads.
+ * `parent` must outlive the fork
+ */
+namespace_t nmsp_fork(namespace_t parent);
+
 // Lookup variable with the given name
 var_t nmsp_get(namespace_t nmsp, const char *key, size_t keylen);
 #define nmsp_getz(nmsp, key) nmsp_get((nmsp), (key), strlen(key))
+// Get the variable which replaces `vr` when seen from `nmsp`
+var_t nmsp_view(namespace_t nmsp, var_t vr);
+
+/* Give variables of `nmsp` the values of those in `src` with the
+ * same name when their definitions and dependencies are the same
+ * The matching variables of `src` are evaluated once and shared
+ * Returns the number of variables whose values were shared
+ */
+size_t nmsp_share(namespace_t nmsp, namespace_t src);
 
 // Create variable with given name but with no expression
 var_t nmsp_put(namespace_t nmsp, const char *key, size_t keylen);
@@ -1,9 +1,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <math.h>
 
 #include "../nmsp.h"
+#include "../util/mcode.h"
 
 // Create namespace and declare variables printing any errors
 namespace_t safe_decl(const char *decls[]);
@@ -20,6 +22,11 @@ int check_parsing();
 int check_func_parsing();
 int check_parse_errs();
 int check_insert_errs();
+int check_rollback();
+int check_shapes();
+int check_forks();
+int check_share();
+int check_reductions();
 
 int main(int argc, char *argv[]){
 	// Count number of failed tests
@@ -33,6 +40,16 @@ int main(int argc, char *argv[]){
 	big_sep();
 	fails += check_insert_errs();
 	big_sep();
+	fails += check_rollback();
+	big_sep();
+	fails += check_shapes();
+	big_sep();
+	fails += check_forks();
+	big_sep();
+	fails += check_share();
+	big_sep();
+	fails += check_reductions();
+	big_sep();
 	
 	printf("\nFailures: %i\n", fails);
 	return 0;
@@ -232,6 +249,278 @@ int check_insert_errs(){
 
 
 
+int check_rollback(){
+	puts("\n### Checking Rollback of Failed Definitions");
+	namespace_t nmsp = nmsp_new(true);
+	int fails = 0;
+	
+	// Words of prose line should not remain as variables
+	if(eval(nmsp,
+		"A sentence whose words will be interpreted",
+		0.0, PARSE_ERR_MISSING_OPERS, EVAL_ERR_OK
+	)) fails++;
+	
+	const char *words[] = {"A", "sentence", "whose", "words", "will", "be", "interpreted", NULL};
+	for(const char **w = words; *w; w++){
+		if(nmsp_getz(nmsp, *w)){
+			printf("**** Placeholder \"%s\" remains after failed parse\n", *w);
+			fails++;
+		}
+	}
+	sep();
+	
+	// Forward declared variable can be defined after a failed definition
+	if(eval(nmsp,
+		"total : part * 2 + 1",
+		0.0, PARSE_ERR_OK, EVAL_ERR_INCOMPLETE_CODE
+	)) fails++;
+	
+	if(eval(nmsp,
+		"part : (3 + extra * 2",
+		0.0, PARSE_ERR_PARENTH_MISMATCH, EVAL_ERR_OK
+	)) fails++;
+	else if(nmsp_getz(nmsp, "extra")){
+		puts("**** Placeholder \"extra\" remains after failed parse");
+		fails++;
+	}
+	
+	if(eval(nmsp,
+		"part : 4",
+		4.0, PARSE_ERR_OK, EVAL_ERR_OK
+	)) fails++;
+	
+	if(eval(nmsp,
+		"part * 2 + 1",
+		9.0, PARSE_ERR_OK, EVAL_ERR_OK
+	)) fails++;
+	
+	nmsp_free(nmsp);
+	return fails;
+}
+
+int check_shapes(){
+	puts("\n### Checking Reuse of Expression Shapes");
+	namespace_t nmsp;
+	int fails = 0;
+	
+	const char *decls[] = {
+		"a : 2", "b : 5", "c : 7", "d : 3",
+		"f(x, y) : x * y + 1",
+		"g(x, y) : x * y + 1",
+		"h(x) : x",
+		NULL
+	};
+	if(!(nmsp = safe_decl(decls))) return 1;
+	
+	// Second expression reuses the code of the first with different variables
+	if(eval(nmsp, "p : (a + b) * 2 - a", 12.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(nmsp, "q : (c + d) * 2 - c", 13.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(nmsp, "(d + d) * 2 - d", 9.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(nmsp, "(a + b) * 3 - 4", 17.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	sep();
+	
+	// Folded constants must match exactly
+	if(eval(nmsp, "a * (2 + 3)", 10.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(nmsp, "b * (2 + 3)", 25.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(nmsp, "b * (1 + 3)", 20.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	sep();
+	
+	// Calls are rebound to the new function
+	if(eval(nmsp, "s : f(a, b) + c", 18.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(nmsp, "t : g(c, d) + a", 24.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	sep();
+	
+	// Same shape with incompatible function falls back to full parse
+	if(eval(nmsp, "h(a, b) + c", 0.0, PARSE_ERR_ARITY_MISMATCH, EVAL_ERR_OK)) fails++;
+	if(eval(nmsp, "(p + h) * 2 - p", 0.0, PARSE_ERR_FUNC_NOCALL, EVAL_ERR_OK)) fails++;
+	
+	nmsp_free(nmsp);
+	return fails;
+}
+
+int check_forks(){
+	puts("\n### Checking Forked Namespaces");
+	namespace_t base, fork;
+	int fails = 0;
+	
+	const char *decls[] = {
+		"a : 2", "b : a * 3", "c : 10",
+		"d : b + c",
+		"f(x) : x * a",
+		NULL
+	};
+	if(!(base = safe_decl(decls))) return 1;
+	fork = nmsp_fork(base);
+	
+	// Override variable and check that dependents change
+	if(eval(fork, "a : 5", 5.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(fork, "d + f(1)", 30.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(base, "d + f(1)", 18.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	
+	// Unaffected variables are shared
+	if(nmsp_getz(fork, "c") != nmsp_getz(base, "c")){
+		puts("**** Unchanged variable \"c\" was copied into fork");
+		fails++;
+	}
+	if(nmsp_getz(fork, "d") == nmsp_getz(base, "d")){
+		puts("**** Dependent variable \"d\" was not copied into fork");
+		fails++;
+	}
+	sep();
+	
+	// Overrides may not depend on what they change
+	if(eval(fork, "c : d", 0.0, INSERT_ERR_CIRC, EVAL_ERR_OK)) fails++;
+	if(eval(fork, "c : 1", 1.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(fork, "d", 16.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	
+	// Copied variables can be overridden but overrides can't be redefined
+	if(eval(fork, "b : 4", 4.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(fork, "d", 5.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	if(eval(fork, "a : 6", 0.0, INSERT_ERR_REDEF, EVAL_ERR_OK)) fails++;
+	if(eval(base, "d", 16.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	
+	nmsp_free(fork);
+	nmsp_free(base);
+	return fails;
+}
+
+int check_share(){
+	puts("\n### Checking Shared Values");
+	namespace_t old, new;
+	int fails = 0;
+	
+	const char *olds[] = {
+		"a : 2", "b : a * 3", "c : 10",
+		"d : b + c", "f(x) : x * a",
+		NULL
+	};
+	const char *news[] = {
+		"f(x) : x * a", "d : b + c",
+		"c : 11", "b : a * 3", "a : 2",
+		NULL
+	};
+	if(!(old = safe_decl(olds))) return 1;
+	if(!(new = safe_decl(news))){
+		nmsp_free(old);
+		return 1;
+	}
+	
+	// Only "a" and "b" keep the same definitions and dependencies
+	size_t count = nmsp_share(new, old);
+	printf("Shared %zu value(s)\n", count);
+	if(count != 2){
+		puts("**** Expected 2 shared values");
+		fails++;
+	}
+	if(nmsp_var_hash(nmsp_getz(new, "d")) != nmsp_var_hash(nmsp_getz(old, "d"))){
+		puts("**** Same definition of \"d\" hashed differently");
+		fails++;
+	}
+	if(eval(new, "d + f(1)", 19.0, PARSE_ERR_OK, EVAL_ERR_OK)) fails++;
+	
+	nmsp_free(new);
+	nmsp_free(old);
+	return fails;
+}
+
+// Define `name(x)` as `n` terms of `term` joined by `op`, where '#' in `term` is the term's index
+static char *chain_expr(const char *name, const char *term, char op, int n){
+	size_t cap = strlen(name) + 16 + n * (strlen(term) + 16), len;
+	char *str = malloc(cap);
+	len = sprintf(str, "%s(x) : ", name);
+	for(int i = 0; i < n; i++){
+		if(i) len += sprintf(str + len, " %c ", op);
+		for(const char *c = term; *c; c++){
+			if(*c == '#') len += sprintf(str + len, "%i", i);
+			else str[len++] = *c;
+		}
+	}
+	str[len] = '\0';
+	return str;
+}
+
+// Evaluate calls of the chains defined by `check_reductions` with one and four threads
+static int check_reduction_values(namespace_t nmsp, int n){
+	int fails = 0;
+	
+	// Results must not depend on the number of threads
+	const char *exprs[] = {"f(3)", "g(1/3)", "g(0.1)", "h(15000)", "h(20000)", "p(2)", NULL};
+	double tgts[] = {3.0 * n * (n - 1) / 2, 0, 0, 0, 0, 1099511627776.0};
+	arith_err_t everrs[] = {EVAL_ERR_OK, EVAL_ERR_OK, EVAL_ERR_OK, ARITH_ERR_DOMAIN, EVAL_ERR_OK, EVAL_ERR_OK};
+	double harm = 0;
+	for(int i = n; i > 0; i--) harm += 1.0 / i;
+	tgts[1] = harm / 3;
+	tgts[2] = harm / 10;
+	
+	for(int i = 0; exprs[i]; i++){
+		arith_t res[2];
+		arith_err_t errs[2];
+		for(int j = 0; j < 2; j++){
+			mcode_set_threads(j ? 4 : 1);
+			const char *endptr;
+			parse_err_t err;
+			var_t vr = nmsp_define(nmsp, exprs[i], &endptr, &err);
+			if(!vr || err){
+				printf("**** Failed to Parse \"%s\": Errno %i\n", exprs[i], err);
+				return fails + 1;
+			}
+			res[j] = nmsp_var_value(vr, errs + j);
+		}
+		printf("%s: Desired Errno: %i  Errno: %i, %i\n", exprs[i], everrs[i], errs[0], errs[1]);
+		if(errs[0] != everrs[i] || errs[1] != everrs[i]){
+			puts("**** Failed to Evaluate Expression");
+			fails++;
+			continue;
+		}
+		if(everrs[i]) continue;
+		
+		printf("Desired Result: %.15g  Results: %.15g, %.15g\n", tgts[i], arith_todbl(res[0]), arith_todbl(res[1]));
+		if(!arith_equal(res[0], res[1])){
+			puts("**** Results differ between threads");
+			fails++;
+		}else if(fabs(tgts[i] - arith_todbl(res[0])) > 1e-12 * fabs(tgts[i])){
+			puts("**** Failed to Evaluate Expression Correctly");
+			fails++;
+		}
+	}
+	mcode_set_threads(0);
+	return fails;
+}
+
+int check_reductions(){
+	puts("\n### Checking Long Reductions");
+	namespace_t nmsp = nmsp_new(true);
+	int fails = 0;
+	
+	// Chains long enough to be split into blocks and a product of 40 terms
+	const int n = 20000;
+	char *defs[] = {
+		chain_expr("f", "x * #", '+', n),
+		chain_expr("g", "x / (# + 1)", '+', n),
+		chain_expr("h", "factorial(x - #)", '+', n),
+		chain_expr("p", "x", '*', 40),
+		NULL
+	};
+	for(char **def = defs; *def; def++){
+		const char *endptr;
+		parse_err_t err;
+		printf("Defining \"%.24s...\"\n", *def);
+		if(!nmsp_define(nmsp, *def, &endptr, &err) || err){
+			printf("**** Failed to Parse Expression: Errno %i\n", err);
+			fails++;
+		}
+	}
+	sep();
+	if(!fails) fails += check_reduction_values(nmsp, n);
+	
+	// Names of variables point into their definitions
+	nmsp_free(nmsp);
+	for(char **def = defs; *def; def++) free(*def);
+	return fails;
+}
+
+
+
 
 namespace_t safe_decl(const char *decls[]){
 	// Create namespace
@@ -274,7 +563,7 @@ bool circ_loop(namespace_t nmsp, const char *chain){
 
 bool eval(namespace_t nmsp, const char *expstr, double tgt, parse_err_t perr, arith_err_t everr){
 	// Parse expression
-	const char *endptr;
+	const char *endptr = expstr;
 	parse_err_t err;
 	printf("Defining Expression \"%s\"\n", expstr);
 	var_t vr = nmsp_define(nmsp, expstr, &endptr, &err);
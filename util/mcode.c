@@ -1,4 +1,9 @@
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "mcode.h"
 
@@ -6,22 +11,37 @@ enum instr_type {
 	INSTR_CONST_LOAD,
 	INSTR_ARG_LOAD,
 	INSTR_CODE_CALL,
-	INSTR_FUNC_CALL
+	INSTR_FUNC_CALL,
+	INSTR_REDUCE
 };
 
+/* Chains of `+` or `*` with at least this many terms are fused into one reduction
+ * Terms of a reduction are combined in blocks of MCODE_BLOCK_TERMS,
+ * each block left to right and then the blocks in order, regardless
+ * of how many threads evaluate them. So results don't depend on threads
+ */
+#define MCODE_FUSE_TERMS (32)
+#define MCODE_BLOCK_TERMS (4096)
+
 // Single instruction
 struct instr_s {
 	enum instr_type type : 4;
 	
 	/* Number of arguments in `func` call
-	 * Only used when type == INSTR_FUNC_CALL
+	 * or number of terms when type == INSTR_REDUCE
 	 */
 	int arity;
 	
 	union {
 		int arg;  // Index of argument
 		
-		arith_func_t func;  // Pointer to function to call
+		struct{
+			arith_func_t func;  // Pointer to function to call
+			/* INSTR_REDUCE: Terms follow the instruction with term `k` ending
+			 * `ends[k]` instructions after it, and are combined by `func`
+			 */
+			size_t *ends;
+		};
 		arith_t value;  // Pointer to constant
 		mcode_t code;  // Pointer to other block of code
 	};
@@ -87,6 +107,7 @@ void mcode_free(mcode_t code){
 	for(size_t i = 0; i < code->len; i++){
 		struct instr_s instr = code->instrs[i];
 		if(instr.type == INSTR_CONST_LOAD) arith_free(instr.value);
+		else if(instr.type == INSTR_REDUCE) free(instr.ends);
 	}
 	
 	free(code->instrs);  // Free instruction vector
@@ -147,6 +168,11 @@ int mcode_get_arity(mcode_t code){
 	return code->arity;
 }
 
+// Return the number of instructions in the code block
+size_t mcode_length(mcode_t code){
+	return code->len;
+}
+
 // Return the stack height of the code block
 int mcode_stack_height(mcode_t code){
 	return code->stk_ht;
@@ -165,6 +191,8 @@ bool mcode_clear(mcode_t code){
 // Remove all instructions and caching from code block
 void mcode_reset(mcode_t code){
 	mcode_clear(code);
+	for(size_t i = 0; i < code->len; i++)
+		if(code->instrs[i].type == INSTR_REDUCE) free(code->instrs[i].ends);
 	code->stk_ht = 0;
 	code->len = 0;
 }
@@ -174,6 +202,59 @@ arith_err_t mcode_error(mcode_t code){
 	return code->err;
 }
 
+// Set cache of constant code block
+bool mcode_seed(mcode_t code, arith_t value, arith_err_t err){
+	if(code->arity != 0) return true;
+	mcode_clear(code);
+	
+	code->is_cached = true;
+	code->err = err;
+	if(!err) code->value = value;
+	return false;
+}
+
+// Combine instructions using FNV-1a steps
+unsigned long mcode_hash(mcode_t code){
+	unsigned long h = 0xcbf29ce484222325;
+	#define mix(x) (h = (h ^ (unsigned long)(x)) * 0x100000001b3)
+	mix(code->arity);
+	
+	size_t calllen = 0;
+	mcode_t *calls = NULL;
+	for(size_t i = 0; i < code->len; i++){
+		struct instr_s *instr = code->instrs + i;
+		mix(instr->type);
+		
+		size_t j;
+		switch(instr->type){
+			case INSTR_CONST_LOAD: mix(arith_hash(instr->value));
+			break;
+			case INSTR_ARG_LOAD: mix(instr->arg);
+			break;
+			case INSTR_FUNC_CALL:
+				mix(instr->arity);
+				mix(instr->func);
+			break;
+			case INSTR_REDUCE:
+				mix(instr->arity);
+				mix(instr->func);
+				mix(instr->ends[instr->arity - 1]);
+			break;
+			case INSTR_CODE_CALL:
+				// Find position of callee among distinct callees
+				if(!calls) calls = mcode_deplist(code, &calllen);
+				for(j = 0; j < calllen && calls[j] != instr->code; j++);
+				mix(instr->arity);
+				mix(j);
+			break;
+		}
+	}
+	#undef mix
+	
+	if(calls) free(calls);
+	return h;
+}
+
 
 
 static inline struct instr_s *instrs_inc(mcode_t code){
@@ -249,17 +330,12 @@ bool mcode_call_func(mcode_t code, int arity, arith_func_t func, bool try_eval){
 			arith_err_t err = ARITH_ERR_OK;
 			arith_t ret = func(args, &err);
 			
-			code->len -= arity;  // Remove instructions
-			code->stk_ht -= arity;  // Update Stack Height
-			
-			// If Error happens cache it
-			if(err){
-				code->is_cached = true;
-				code->err = err;
-				return true;
+			// Calls which fail are kept so the error is reported on evaluation
+			if(!err){
+				code->len -= arity;  // Remove instructions
+				code->stk_ht -= arity;  // Update Stack Height
+				return mcode_load_const(code, ret);
 			}
-			
-			return mcode_load_const(code, ret);
 		}
 	}
 	
@@ -273,6 +349,171 @@ bool mcode_call_func(mcode_t code, int arity, arith_func_t func, bool try_eval){
 }
 
 
+bool mcode_append(mcode_t code, mcode_t src, mcode_t *olds, mcode_t *news, size_t n, arith_t *consts){
+	if(!code || !src || code->stk_ht < 0 || src->stk_ht < 0) return true;
+	mcode_clear(code);  // Clear any cache if present
+	
+	// Make space for all instructions at once
+	if(code->len + src->len > code->cap){
+		code->cap = code->len + src->len;
+		code->instrs = realloc(code->instrs, code->cap * sizeof(struct instr_s));
+	}
+	
+	struct instr_s *instr = code->instrs + code->len;
+	for(size_t i = 0; i < src->len; i++, instr++){
+		*instr = src->instrs[i];
+		if(instr->type == INSTR_CONST_LOAD)
+			instr->value = consts ? *(consts++) : arith_clone(instr->value);
+		else if(instr->type == INSTR_REDUCE){
+			instr->ends = malloc(instr->arity * sizeof(size_t));
+			memcpy(instr->ends, src->instrs[i].ends, instr->arity * sizeof(size_t));
+		}else if(instr->type == INSTR_CODE_CALL){
+			// Replace callee if it should be rebound
+			for(size_t j = 0; j < n; j++) if(instr->code == olds[j]){
+				instr->code = news[j];
+				break;
+			}
+		}
+	}
+	
+	code->len += src->len;
+	code->stk_ht += src->stk_ht;  // Update Stack Height
+	return false;
+}
+
+
+// Fused chain of `+` or `*`
+struct chain_s {
+	size_t start, top;  // Index of first instruction and of last operator
+	size_t hdr;  // Index of reduction in fused code
+	int nterm;  // Number of terms whose ends are known
+};
+
+static int chain_cmp(const void *a, const void *b){
+	const struct chain_s *x = a, *y = b;
+	// Chains starting at the same instruction are nested, outermost first
+	if(x->start != y->start) return x->start < y->start ? -1 : 1;
+	return x->top < y->top ? 1 : x->top > y->top ? -1 : 0;
+}
+
+bool mcode_fuse(mcode_t code){
+	size_t n = code->len;
+	if(code->stk_ht != 1 || n < 2 * MCODE_FUSE_TERMS) return false;
+	struct instr_s *instrs = code->instrs;
+	
+	// Find where the value produced by each instruction starts
+	size_t *starts = malloc(n * sizeof(size_t));
+	size_t *stk = malloc(n * sizeof(size_t)), top = 0;
+	// Number of operators in the chain ending with each instruction
+	size_t *links = calloc(n, sizeof(size_t));
+	// Chain owning each operator or -1 for kept instructions
+	long *owner = malloc(n * sizeof(long));
+	
+	size_t i;
+	bool fusable = false;
+	for(i = 0; i < n; i++){
+		struct instr_s *instr = instrs + i;
+		owner[i] = -1;
+		
+		int arity = 0;
+		if(instr->type == INSTR_CODE_CALL || instr->type == INSTR_FUNC_CALL) arity = instr->arity;
+		else if(instr->type != INSTR_CONST_LOAD && instr->type != INSTR_ARG_LOAD) break;
+		if(arity < 0 || top < arity) break;
+		
+		top -= arity;
+		starts[i] = arity ? stk[top] : i;
+		stk[top++] = starts[i];
+		
+		// Left operand of a chained operator is the same operator
+		if(instr->type == INSTR_FUNC_CALL && arity == 2
+		&& (instr->func == arith_add || instr->func == arith_mul)){
+			size_t left = starts[i - 1] - 1;
+			struct instr_s *prev = instrs + left;
+			links[i] = 1;
+			if(prev->type == INSTR_FUNC_CALL && prev->arity == 2 && prev->func == instr->func){
+				links[i] += links[left];
+				links[left] = 0;  // Only the last operator of a chain keeps its length
+			}
+			if(links[i] + 1 >= MCODE_FUSE_TERMS) fusable = true;
+		}
+	}
+	free(stk);
+	
+	// Leave code with unrecognized instructions or no long chains untouched
+	if(i < n || !fusable){
+		free(starts);
+		free(links);
+		free(owner);
+		return false;
+	}
+	
+	// Collect chains, outermost first when they start together
+	size_t nchain = 0, nops = 0;
+	for(i = 0; i < n; i++) if(links[i] + 1 >= MCODE_FUSE_TERMS) nchain++;
+	struct chain_s *chains = malloc(nchain * sizeof(struct chain_s));
+	nchain = 0;
+	for(i = 0; i < n; i++) if(links[i] + 1 >= MCODE_FUSE_TERMS){
+		struct chain_s *ch = chains + nchain++;
+		ch->start = starts[i];
+		ch->top = i;
+		ch->nterm = 0;
+	}
+	qsort(chains, nchain, sizeof(struct chain_s), chain_cmp);
+	
+	// Mark operators of each chain to be removed
+	for(size_t c = 0; c < nchain; c++){
+		size_t op = chains[c].top;
+		for(size_t k = 0; k < links[chains[c].top]; k++){
+			owner[op] = c;
+			op = starts[op - 1] - 1;
+		}
+		nops += links[chains[c].top];
+	}
+	
+	// Emit kept instructions with a reduction before the first term of each chain
+	struct instr_s *fused = malloc((n - nops + nchain) * sizeof(struct instr_s));
+	size_t *outpos = malloc(n * sizeof(size_t));
+	size_t len = 0, c = 0;
+	for(i = 0; i < n; i++){
+		outpos[i] = len;
+		for(; c < nchain && chains[c].start == i; c++){
+			struct chain_s *ch = chains + c;
+			ch->hdr = len;
+			struct instr_s *hdr = fused + len++;
+			hdr->type = INSTR_REDUCE;
+			hdr->func = instrs[ch->top].func;
+			hdr->arity = 0;
+			hdr->ends = NULL;
+		}
+		
+		if(owner[i] < 0){
+			fused[len++] = instrs[i];
+			continue;
+		}
+		
+		// Removed operator ends its right operand
+		struct chain_s *ch = chains + owner[i];
+		struct instr_s *hdr = fused + ch->hdr;
+		if(!hdr->ends){
+			hdr->arity = links[ch->top] + 1;
+			hdr->ends = malloc(hdr->arity * sizeof(size_t));
+			// First operator also ends the leftmost term
+			hdr->ends[ch->nterm++] = outpos[starts[i - 1]] - ch->hdr - 1;
+		}
+		hdr->ends[ch->nterm++] = len - ch->hdr - 1;
+	}
+	
+	free(code->instrs);
+	code->instrs = fused;
+	code->len = code->cap = len;
+	
+	free(outpos);
+	free(chains);
+	free(starts);
+	free(links);
+	free(owner);
+	return true;
+}
 
 
 
@@ -283,6 +524,7 @@ bool mcode_call_func(mcode_t code, int arity, arith_func_t func, bool try_eval){
 struct stack_s {
 	size_t top, cap;  // Index of top of stack and capacity
 	arith_t *ptr;  // Pointer to beginning of stack
+	bool par;  // Whether reductions may be split across threads
 };
 
 // Push value onto stack and return the its index
@@ -294,32 +536,34 @@ static arith_t *stk_push(struct stack_s *stk){
 	return stk->ptr + (stk->top++);
 }
 
+static arith_err_t mcode_eval_stk(mcode_t code, arith_t *args, size_t argbase, struct stack_s *stk);
+static arith_err_t eval_reduce(mcode_t code, size_t at, arith_t *args, size_t argbase, struct stack_s *stk);
 
 
-static arith_err_t mcode_eval_stk(mcode_t code, arith_t *args, struct stack_s *stk){
-	if(code->is_cached){  // Check for cached value
-		*stk_push(stk) = arith_clone(code->value);
-		return code->err;
-	}
-	
-	if(code->stk_ht != 1){  // Check that code block is valid
-		return EVAL_ERR_INCOMPLETE_CODE;
-	}
-	
-	size_t start = stk->top;  // Save starting position of top
-	
-	// Execute instructions
+
+/* Execute instructions `from` up to `to` of code block
+ * Arguments are read from `args` or, if it is NULL, from the stack at `argbase`
+ * Stack arguments are accessed by index since pushing may move the stack
+ */
+static arith_err_t eval_instrs(mcode_t code, size_t from, size_t to, arith_t *args, size_t argbase, struct stack_s *stk){
 	arith_err_t err = EVAL_ERR_OK;
-	for(size_t i = 0; i < code->len && !err; i++){
+	for(size_t i = from; i < to && !err; i++){
 		struct instr_s instr = code->instrs[i];
 		int argidx;  // Stack index of first call argument
+		arith_t value;
 		
 		switch(instr.type){
 			case INSTR_CONST_LOAD:  // Place copy of value on stack
 				*stk_push(stk) = arith_clone(instr.value);
 			break;
 			case INSTR_ARG_LOAD:  // Place copy of argument on stack
-				*stk_push(stk) = arith_clone(args[instr.arg]);
+				value = arith_clone(args ? args[instr.arg] : stk->ptr[argbase + instr.arg]);
+				*stk_push(stk) = value;
+			break;
+			
+			case INSTR_REDUCE:  // Combine terms and skip past them
+				err = eval_reduce(code, i, args, argbase, stk);
+				i += instr.ends[instr.arity - 1];
 			break;
 			
 			case INSTR_CODE_CALL:  // Call another code section
@@ -336,7 +580,7 @@ static arith_err_t mcode_eval_stk(mcode_t code, arith_t *args, struct stack_s *s
 				}
 				
 				if(instr.type == INSTR_CODE_CALL){  // Call other code segment
-					err = mcode_eval_stk(instr.code, stk->ptr + argidx, stk);
+					err = mcode_eval_stk(instr.code, NULL, argidx, stk);
 				}else{
 					// Call function and place return value above arguments
 					arith_t *ret = stk_push(stk);
@@ -354,6 +598,23 @@ static arith_err_t mcode_eval_stk(mcode_t code, arith_t *args, struct stack_s *s
 			default: err = EVAL_ERR_UNKNOWN_INSTR;
 		}
 	}
+	return err;
+}
+
+static arith_err_t mcode_eval_stk(mcode_t code, arith_t *args, size_t argbase, struct stack_s *stk){
+	if(code->is_cached){  // Check for cached value
+		*stk_push(stk) = arith_clone(code->value);
+		return code->err;
+	}
+	
+	if(code->stk_ht != 1){  // Check that code block is valid
+		return EVAL_ERR_INCOMPLETE_CODE;
+	}
+	
+	size_t start = stk->top;  // Save starting position of top
+	
+	// Execute instructions
+	arith_err_t err = eval_instrs(code, 0, code->len, args, argbase, stk);
 	
 	// Check for incorrect number of arguments after execution
 	if(!err){
@@ -372,6 +633,208 @@ static arith_err_t mcode_eval_stk(mcode_t code, arith_t *args, struct stack_s *s
 	return err;
 }
 
+
+
+/*  Reductions
+ * ============
+ */
+// Number of threads used to evaluate a reduction, 0 when not yet chosen
+static int threads = 0;
+static pthread_once_t threads_once = PTHREAD_ONCE_INIT;
+
+static int cpu_count(void){
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus > 1 ? cpus : 1;
+}
+
+static void threads_init(void){
+	if(threads == 0) threads = cpu_count();
+}
+
+void mcode_set_threads(int n){
+	pthread_once(&threads_once, threads_init);
+	threads = n > 0 ? n : cpu_count();
+}
+
+// Running result of a reduction
+struct reduce_s {
+	arith_func_t func;
+	bool empty;
+	arith_t acc;
+	double comp;  // Lost low-order part of Real sums (Neumaier summation)
+};
+
+static arith_err_t reduce_put(struct reduce_s *red, arith_t val){
+	if(red->empty){
+		red->acc = val;
+		red->empty = false;
+		return ARITH_ERR_OK;
+	}
+	
+	arith_err_t err = ARITH_ERR_OK;
+	arith_t pair[2] = {red->acc, val};
+	arith_t res = red->func(pair, &err);
+	if(err) return err;
+	
+	// Keep what rounding discarded from the larger operand
+	if(red->func == arith_add && res.type == ARITH_REAL && isfinite(res.real)){
+		double x = arith_todbl(red->acc), y = arith_todbl(val);
+		red->comp += fabs(x) >= fabs(y) ? (x - res.real) + y : (y - res.real) + x;
+	}
+	arith_free(red->acc);
+	arith_free(val);
+	red->acc = res;
+	return ARITH_ERR_OK;
+}
+
+static arith_t reduce_end(struct reduce_s *red){
+	if(red->acc.type == ARITH_REAL && isfinite(red->comp)) red->acc.real += red->comp;
+	return red->acc;
+}
+
+// Combine terms `from` up to `to` of the reduction at instruction `at`
+static arith_err_t reduce_block(mcode_t code, size_t at, size_t from, size_t to, arith_t *args, size_t argbase, struct stack_s *stk, arith_t *out){
+	struct instr_s *instr = code->instrs + at;
+	struct reduce_s red = {.func = instr->func, .empty = true, .comp = 0};
+	
+	arith_err_t err = EVAL_ERR_OK;
+	for(size_t k = from; k < to && !err; k++){
+		size_t base = stk->top;
+		err = eval_instrs(code, at + 1 + (k ? instr->ends[k - 1] : 0), at + 1 + instr->ends[k], args, argbase, stk);
+		if(!err && stk->top != base + 1) err = EVAL_ERR_STACK_SURPLUS;
+		if(!err) err = reduce_put(&red, stk->ptr[--stk->top]);
+	}
+	
+	if(err){
+		if(!red.empty) arith_free(red.acc);
+		return err;
+	}
+	*out = reduce_end(&red);
+	return EVAL_ERR_OK;
+}
+
+/* Evaluate every constant called by instructions `from` up to `to`
+ * so that threads evaluating them only read the cached values
+ */
+static void fill_caches(mcode_t code, size_t from, size_t to, mcode_t **seen, size_t *nseen){
+	for(size_t i = from; i < to; i++){
+		struct instr_s *instr = code->instrs + i;
+		if(instr->type != INSTR_CODE_CALL) continue;
+		
+		mcode_t callee = instr->code;
+		if(callee->arity == 0){
+			if(!callee->is_cached) arith_free(mcode_eval(callee, NULL, NULL));
+			continue;
+		}
+		
+		// Functions are searched once for the constants they call
+		size_t j;
+		for(j = 0; j < *nseen && (*seen)[j] != callee; j++);
+		if(j < *nseen) continue;
+		*seen = realloc(*seen, (*nseen + 1) * sizeof(mcode_t));
+		(*seen)[(*nseen)++] = callee;
+		fill_caches(callee, 0, callee->len, seen, nseen);
+	}
+}
+
+// Blocks of a reduction shared by threads
+struct reduce_job_s {
+	mcode_t code;
+	size_t at;
+	arith_t *args;
+	
+	size_t nblock;
+	atomic_size_t next;  // Next block to take
+	arith_t *parts;  // Result and error of each block
+	arith_err_t *errs;
+};
+
+static void *reduce_worker(void *arg){
+	struct reduce_job_s *job = arg;
+	size_t nterm = job->code->instrs[job->at].arity;
+	
+	// Nested reductions stay on this thread
+	struct stack_s stk;
+	stk.top = 0;
+	stk.cap = 8;
+	stk.ptr = malloc(stk.cap * sizeof(arith_t));
+	stk.par = false;
+	
+	size_t b;
+	while((b = atomic_fetch_add(&job->next, 1)) < job->nblock){
+		size_t from = b * MCODE_BLOCK_TERMS, to = from + MCODE_BLOCK_TERMS;
+		stk.top = 0;
+		job->errs[b] = reduce_block(job->code, job->at, from, to < nterm ? to : nterm, job->args, 0, &stk, job->parts + b);
+	}
+	
+	free(stk.ptr);
+	return NULL;
+}
+
+// Evaluate reduction at instruction `at` placing its result on the stack
+static arith_err_t eval_reduce(mcode_t code, size_t at, arith_t *args, size_t argbase, struct stack_s *stk){
+	struct instr_s *instr = code->instrs + at;
+	size_t nterm = instr->arity;
+	size_t nblock = (nterm + MCODE_BLOCK_TERMS - 1) / MCODE_BLOCK_TERMS;
+	if(nblock == 1){
+		arith_t res;
+		arith_err_t err = reduce_block(code, at, 0, nterm, args, argbase, stk, &res);
+		if(!err) *stk_push(stk) = res;
+		return err;
+	}
+	
+	struct reduce_job_s job = {.code = code, .at = at, .args = args, .nblock = nblock};
+	job.parts = malloc(nblock * sizeof(arith_t));
+	job.errs = malloc(nblock * sizeof(arith_err_t));
+	atomic_init(&job.next, 0);
+	
+	pthread_once(&threads_once, threads_init);
+	size_t nthread = (size_t)threads < nblock ? (size_t)threads : nblock;
+	if(!stk->par) nthread = 1;
+	
+	arith_err_t err = EVAL_ERR_OK;
+	if(nthread > 1){
+		// Arguments on the stack are left in place while threads read them
+		if(!args) job.args = stk->ptr + argbase;
+		
+		size_t nseen = 0;
+		mcode_t *seen = NULL;
+		fill_caches(code, at + 1, at + 1 + instr->ends[nterm - 1], &seen, &nseen);
+		free(seen);
+		
+		pthread_t tids[nthread - 1];
+		size_t nstarted = 0;
+		for(; nstarted < nthread - 1; nstarted++)
+			if(pthread_create(tids + nstarted, NULL, reduce_worker, &job)) break;
+		reduce_worker(&job);
+		for(size_t t = 0; t < nstarted; t++) pthread_join(tids[t], NULL);
+		
+		// Report error of first failing block
+		for(size_t b = 0; b < nblock && !err; b++) err = job.errs[b];
+		if(err) for(size_t b = 0; b < nblock; b++) if(!job.errs[b]) arith_free(job.parts[b]);
+	}else{
+		for(size_t b = 0; b < nblock && !err; b++){
+			size_t from = b * MCODE_BLOCK_TERMS, to = from + MCODE_BLOCK_TERMS;
+			err = reduce_block(code, at, from, to < nterm ? to : nterm, args, argbase, stk, job.parts + b);
+			if(err) for(size_t p = 0; p < b; p++) arith_free(job.parts[p]);
+		}
+	}
+	
+	// Combine results of blocks in order
+	if(!err){
+		struct reduce_s red = {.func = instr->func, .empty = true, .comp = 0};
+		size_t b;
+		for(b = 0; b < nblock && !err; b++) err = reduce_put(&red, job.parts[b]);
+		for(; b < nblock; b++) arith_free(job.parts[b]);
+		if(err) arith_free(red.acc);
+		else *stk_push(stk) = reduce_end(&red);
+	}
+	
+	free(job.parts);
+	free(job.errs);
+	return err;
+}
+
 arith_t mcode_eval(mcode_t code, arith_t *args, arith_err_t *errp){
 	if(code->is_cached){  // Check for cached value
 		if(errp) *errp = code->err;
@@ -383,9 +846,10 @@ arith_t mcode_eval(mcode_t code, arith_t *args, arith_err_t *errp){
 	stk.top = 0;
 	stk.cap = 8;
 	stk.ptr = malloc(stk.cap * sizeof(arith_t));
+	stk.par = true;
 	
 	// Evaluate code with stack
-	arith_err_t err = mcode_eval_stk(code, args, &stk);
+	arith_err_t err = mcode_eval_stk(code, args, 0, &stk);
 	if(errp) *errp = err;
 	
 	// Get return value
@@ -39,6 +39,9 @@ int mcode_set_arity(mcode_t code, int new_arity);
 // Get current arity
 int mcode_get_arity(mcode_t code);
 
+// Return the number of instructions in code block
+size_t mcode_length(mcode_t code);
+
 // Return the stack height of code block
 // Code block is only valid if Stack Height = 1
 int mcode_stack_height(mcode_t code);
@@ -50,6 +53,16 @@ bool mcode_clear(mcode_t code);
 void mcode_reset(mcode_t code);
 // Return cached error if present
 arith_err_t mcode_error(mcode_t code);
+/* Cache `value` and `err` as the result of code block without evaluating it
+ * Returns true if the code block takes arguments
+ */
+bool mcode_seed(mcode_t code, arith_t value, arith_err_t err);
+
+/* Hash instructions of code block
+ * Calls are hashed by the position of the callee
+ * in the list produced by `mcode_deplist`
+ */
+unsigned long mcode_hash(mcode_t code);
 
 
 /* Append instructions to the code block
@@ -60,9 +73,29 @@ bool mcode_load_arg(mcode_t code, int arg);
 bool mcode_call_code(mcode_t code, mcode_t callee);
 bool mcode_call_func(mcode_t code, int arity, arith_func_t func, bool try_eval);
 
+/* Append copy of the instructions in `src` to the code block
+ * Calls to `olds[i]` are replaced by calls to `news[i]`
+ * If `consts` is not NULL then the constants loaded by `src` are
+ * replaced, in order, by the values of `consts` which are consumed
+ * Returns false on success, true otherwise
+ */
+bool mcode_append(mcode_t code, mcode_t src, mcode_t *olds, mcode_t *news, size_t n, arith_t *consts);
+
+/* Replace long chains of `+` or `*` with single reductions
+ * whose terms may be evaluated by separate threads
+ * Should only be used once code block is complete
+ * Returns true if any chain was replaced
+ */
+bool mcode_fuse(mcode_t code);
+
 
 // Execute the instructions in the code to get value
 arith_t mcode_eval(mcode_t code, arith_t *args, arith_err_t *errp);
 
+/* Set number of threads used to evaluate long reductions
+ * Defaults to the number of processors when `n` <= 0
+ */
+void mcode_set_threads(int n);
+
 #endif
 